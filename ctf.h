@@ -10,7 +10,7 @@
  *
  * @copyright Copyright (c) 2025
  *
- * @warning Untested for multi-threaded signal exceptions.
+ * @warning Untested for multi-threaded signal exceptions outside of the -j worker pool and CTF_TEST_THREADED bodies.
  *
  */
 
@@ -23,6 +23,133 @@
 #include <time.h>
 #include <string.h>
 #include <stdarg.h>
+#include <errno.h>
+
+/* Set before the includes, a translation unit that only gets the declarations (see CTF_SHARED) needs none of those below */
+#if defined(CTF_SHARED) && !defined(CTF_IMPLEMENTATION)
+#define __CTF_DECLARATIONS_ONLY 1
+#endif
+
+/* The runtime is C, a C++ translation unit can only use the declarations */
+#if defined(__cplusplus) && !defined(__CTF_DECLARATIONS_ONLY)
+#error "Include ctf.h from C++ only with CTF_SHARED, and compile the CTF_IMPLEMENTATION translation unit as C."
+#endif
+
+#ifndef __CTF_DECLARATIONS_ONLY
+#include <stdatomic.h>
+
+/*
+    The worker pool, timeouts, crash capture, --isolate and the perf counters need POSIX.1-2008 with the BSD and GNU
+    extensions (sigaltstack, syscall, the registers in mcontext_t). The C library only declares those when the build
+    asks for them: any -std=gnu* mode does, a strict -std=c11 needs -D_DEFAULT_SOURCE or -D_GNU_SOURCE on the command
+    line. The header never defines them itself, it would be too late after another system header and would change
+    what the rest of the translation unit sees. Without them the portable runtime of plain C is used.
+*/
+#if defined(__APPLE__) || (defined(__unix__) && (defined(_DEFAULT_SOURCE) || defined(_BSD_SOURCE) || defined(_GNU_SOURCE)))
+#define __CTF_POSIX 1
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#ifdef CTF_RUNNER
+#include <dlfcn.h>
+#include <poll.h>
+#endif
+#endif
+
+#if defined(__linux__) && defined(__CTF_POSIX)
+#include <ucontext.h>
+#ifdef CTF_RUNNER
+#include <sys/inotify.h>
+#endif
+#endif
+
+/* backtrace() for crash reports */
+#if defined(__CTF_POSIX) && (defined(__GLIBC__) || defined(__APPLE__))
+#include <execinfo.h>
+#define __CTF_HAS_BACKTRACE 1
+#endif
+
+#if defined(__linux__) && defined(__CTF_POSIX)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#define __CTF_HAS_PERF_EVENT 1
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+#include <cpuid.h>
+#define __CTF_HAS_RDTSC 1
+#endif
+
+/* Comparison kernels of the bulk assertions, AVX2 is picked at runtime since the header can't assume it */
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define __CTF_HAS_SSE2 1
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define __CTF_HAS_AVX2_DISPATCH 1
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define __CTF_HAS_NEON 1
+#endif
+#endif /* __CTF_DECLARATIONS_ONLY */
+
+/* Per-worker state is thread local so suites can run on several threads (see -j) */
+#if defined(_MSC_VER)
+#define __CTF_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#define __CTF_THREAD_LOCAL _Thread_local
+#else
+#define __CTF_THREAD_LOCAL __thread
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define __CTF_PRINTF_FORMAT(fmt, args) __attribute__((format(printf, fmt, args)))
+/* For helpers only reached through macros the user may never expand */
+#define __CTF_MAYBE_UNUSED __attribute__((unused))
+/* Failure paths, kept out of line so passing asserts cost only their check */
+#define __CTF_COLD __attribute__((cold, noinline))
+#define __CTF_UNLIKELY(cond) __builtin_expect(!!(cond), 0)
+#else
+#define __CTF_PRINTF_FORMAT(fmt, args)
+#define __CTF_MAYBE_UNUSED
+#define __CTF_COLD
+#define __CTF_UNLIKELY(cond) (cond)
+#endif
+
+/* Restore the signal mask on recovery so a worker can catch the same signal again */
+#ifdef __CTF_POSIX
+#define __CTF_JMP_BUF sigjmp_buf
+#define __CTF_SETJMP(env) sigsetjmp(env, 1)
+#define __CTF_LONGJMP(env, val) siglongjmp(env, val)
+#else
+#define __CTF_JMP_BUF jmp_buf
+#define __CTF_SETJMP(env) setjmp(env)
+#define __CTF_LONGJMP(env, val) longjmp(env, val)
+#endif
+
+/*
+    Define CTF_ALLOC_TRACKING before including this header to count the heap allocations of every test. The header
+    then defines malloc, calloc, realloc and free itself and forwards them to glibc, so it must only be included with
+    it in one translation unit.
+*/
+#ifdef CTF_ALLOC_TRACKING
+#if !defined(__GLIBC__)
+#error "CTF_ALLOC_TRACKING forwards to the glibc allocator and is only supported with glibc."
+#endif
+#include <malloc.h>
+#define __CTF_ALLOC_TRACKING 1
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
 
 /* Use anywhere to log to CTF_LOG_FILE_NAME */
 #define CTF_LOG(...) __CTF_LOG_IMPL(CTF_LOG_FILE_NAME, __VA_ARGS__)
@@ -31,6 +158,59 @@
 #define CTF_LOG_FILE_NAME __CTF_LOG_FILE_NAME
 /* Use to declare a test */
 #define CTF_TEST(test_name) __CTF_MAKE(test_name)
+/* Use to declare a benchmark, link it into a suite like a test */
+#define CTF_BENCH(bench_name) __CTF_BENCH(bench_name)
+/* Use to declare a benchmark run at N = lo, lo * multiplier, ... hi, reports the complexity that fits best */
+#define CTF_BENCH_RANGE(bench_name, lo, hi, multiplier) __CTF_BENCH_RANGE(bench_name, lo, hi, multiplier)
+/* Use in CTF_BENCH around the code to measure */
+#define CTF_BENCH_LOOP __CTF_BENCH_LOOP
+/* Use in CTF_BENCH_RANGE, the current input size */
+#define CTF_RANGE_N __CTF_RANGE_N
+/* Use in benchmarks, items or bytes processed by one iteration of CTF_BENCH_LOOP, reported per second */
+#define CTF_SET_ITEMS(count) __CTF_SET_ITEMS(count)
+#define CTF_SET_BYTES(count) __CTF_SET_BYTES(count)
+/* Use in CTF_BENCH_RANGE, fail if a higher order than CTF_O_* fits the timings better */
+#define CTF_EXPECT_COMPLEXITY(order) __CTF_EXPECT_COMPLEXITY(order)
+#define CTF_O_1 __CTF_O_1
+#define CTF_O_LOG_N __CTF_O_LOG_N
+#define CTF_O_N __CTF_O_N
+#define CTF_O_N_LOG_N __CTF_O_N_LOG_N
+#define CTF_O_N_SQUARED __CTF_O_N_SQUARED
+#define CTF_DO_NOT_OPTIMIZE(value) __CTF_DO_NOT_OPTIMIZE(value)
+/* Use at file scope to register a test or benchmark into a suite at compile time, no CTF_SUITE_LINK needed */
+#define CTF_REGISTER(suite, test_name) __CTF_REGISTER(suite, test_name)
+/* Declares and registers a test in one go */
+#define CTF_AUTO_TEST(suite, test_name) __CTF_AUTO_TEST(suite, test_name)
+/* Use to declare a test that is aborted and reported as timed out after ms milliseconds */
+#define CTF_TEST_TIMEOUT(test_name, ms) __CTF_MAKE_TIMEOUT(test_name, ms)
+/* Use to declare a fixture, setup returns a void * that teardown gets back, both run around every test using it */
+#define CTF_FIXTURE(fixture_name, setup, teardown) __CTF_FIXTURE(fixture_name, setup, teardown)
+/* Use to declare a test that runs between the setup and teardown of fixture_name */
+#define CTF_TEST_FIXTURE(test_name, fixture_name) __CTF_MAKE_FIXTURE(test_name, fixture_name)
+/* Use in CTF_TEST_FIXTURE, what the setup of the fixture returned */
+#define CTF_FIXTURE_DATA __ctf_fixture_data
+/* Use to declare a test that runs once per element of the static array cases, each reported as test_name[i] */
+#define CTF_TEST_PARAM(test_name, type, cases) __CTF_MAKE_PARAM(test_name, type, cases)
+/* Use in CTF_TEST_PARAM, the current element and its index */
+#define CTF_PARAM (*__ctf_param)
+#define CTF_PARAM_INDEX __ctf_param_index
+/* Use to declare a test whose body runs on nthreads pinned threads started together, 0 for one per CPU */
+#define CTF_TEST_THREADED(test_name, nthreads) __CTF_MAKE_THREADED(test_name, nthreads)
+/* Use in CTF_TEST_THREADED, the running thread's index, the number of threads, ops to count toward the ops/s report
+   and whether another thread failed already */
+#define CTF_THREAD_INDEX (__ctf_thread->index)
+#define CTF_THREAD_COUNT (__ctf_thread->count)
+#define CTF_THREAD_OPS(count) __CTF_THREAD_OPS(count)
+#define CTF_THREAD_STOPPED() __CTF_THREAD_STOPPED(__ctf_thread)
+/* Use to declare a property checked against random inputs from the given CTF_GEN_* generators */
+#define CTF_PROPERTY(prop_name, ...) __CTF_PROPERTY(prop_name, __VA_ARGS__)
+#define CTF_GEN_INT(lo, hi) __CTF_GEN_INT(lo, hi)
+#define CTF_GEN_BOOL() __CTF_GEN_INT(0, 1)
+#define CTF_GEN_DOUBLE(lo, hi) __CTF_GEN_DOUBLE(lo, hi)
+/* Use in CTF_PROPERTY, the generated value of the i-th generator */
+#define CTF_ARG_INT(index) (__ctf_prop_args[index].i)
+#define CTF_ARG_BOOL(index) (__ctf_prop_args[index].i != 0)
+#define CTF_ARG_DOUBLE(index) (__ctf_prop_args[index].d)
 /* Use in CTF_TEST */
 #define CTF_PASS() __CTF_PASS()
 #define CTF_FAIL() __CTF_FAIL()
@@ -38,6 +218,20 @@
 #define CTF_ASSERT_LOG(cond, ...) __CTF_ASSERT_LOG(cond, __VA_ARGS__)
 #define CTF_ASSERT_CLEAN(cond, ...) __CTF_ASSERT_CLEAN(cond, __VA_ARGS__)
 #define CTF_ASSERT_CLEAN_LOG(cond, clean_func, ...) __CTF_ASSERT_CLEAN_LOG(cond, clean_func, __VA_ARGS__)
+/* Compare whole buffers and report the first mismatch with a hexdump around it */
+#define CTF_ASSERT_MEM_EQ(a, b, size) __CTF_ASSERT_MEM_EQ(a, b, size)
+#define CTF_ASSERT_ARRAY_EQ(type, a, b, count) __CTF_ASSERT_ARRAY_EQ(type, a, b, count)
+#define CTF_ASSERT_ARRAY_NEAR(type, a, b, count, eps) __CTF_ASSERT_ARRAY_NEAR(type, a, b, count, eps)
+/* Timeline events for --trace, a span lasts until the end of the enclosing scope */
+#define CTF_SPAN(name) __CTF_SPAN(name)
+#define CTF_COUNTER(name, value) __CTF_COUNTER(name, value)
+/* Scratch memory that lives until the end of the test, no need to free it */
+#define CTF_ALLOC(size) __CTF_ARENA_ALLOC(size)
+#define CTF_ARENA_RESET() __CTF_ARENA_RESET()
+/* Allocation budgets for the test so far, need CTF_ALLOC_TRACKING */
+#define CTF_ASSERT_MAX_ALLOCS(n) __CTF_ASSERT_MAX_ALLOCS(n)
+#define CTF_ASSERT_MAX_BYTES(n) __CTF_ASSERT_MAX_BYTES(n)
+#define CTF_ASSERT_NO_LEAKS() __CTF_ASSERT_NO_LEAKS()
 /* Wrap clean_func input of CTF_ASSERT_CLEAN_LOG*/
 #define CTF_CLEAN_FUNC(...) __CTF_CLEAN_FUNC(__VA_ARGS__)
 #define CTF_CODE(...) __CTF_CODE(__VA_ARGS__)
@@ -46,12 +240,23 @@
 #define CTF_SUITE(name, ...) __CTF_SUITE(name, __VA_ARGS__)
 #define CTF_SUITE_MAKE(name) __CTF_SUITE_MAKE(name)
 #define CTF_SUITE_INIT(name) __CTF_SUITE_INIT(name)
+/* Use to define hooks run once before and after the selected tests of a suite, they end like a test */
+#define CTF_SUITE_SETUP(name) __CTF_SUITE_SETUP(name)
+#define CTF_SUITE_TEARDOWN(name) __CTF_SUITE_TEARDOWN(name)
 /* Use in CTF_SUITE or in CTF_SUITE_MAKE */
 #define CTF_SUITE_LINK(__suite, test) __CTF_SUITE_LINK(__suite, test)
+#define CTF_SUITE_LINK_SETUP(name) __CTF_SUITE_LINK_SETUP(name)
+#define CTF_SUITE_LINK_TEARDOWN(name) __CTF_SUITE_LINK_TEARDOWN(name)
 #define CTF_LINK(__suite, test) __CTF_SUITE_LINK(__suite, test)
 #define CTF_SUITE_END(name) __CTF_SUITE_END(name)
 /* Use in main function */
 #define CTF_SUITE_RUN(name) __CTF_SUITE_RUN(name)
+/* Adds a __CTF_Reporter that receives every suite and test event */
+#define CTF_REPORTER_ADD(reporter) __CTF_REPORTER_ADD(reporter)
+/* Runs every test registered with CTF_REGISTER/CTF_AUTO_TEST */
+#define CTF_RUN_REGISTERED() __CTF_RUN_REGISTERED()
+/* Runs every suite made with CTF_SUITE/CTF_SUITE_MAKE in any translation unit */
+#define CTF_RUN_SUITES() __CTF_RUN_SUITES()
 #define CTF_PROCESS_INIT() __CTF_PROCESS_INIT()
 #define CTF_PROCESS_EXIT() __CTF_PROCESS_EXIT()
 /* Misc */
@@ -73,6 +278,55 @@
 #define TEST_LOG_FILE_NAME __CTF_LOG_FILE_NAME
 /* Use to declare a test */
 #define TEST_MAKE(test_name) __CTF_MAKE(test_name)
+/* Use to declare a benchmark, link it into a suite like a test */
+#define TEST_BENCH(bench_name) __CTF_BENCH(bench_name)
+/* Use in TEST_BENCH around the code to measure */
+#define TEST_BENCH_LOOP __CTF_BENCH_LOOP
+#define TEST_BENCH_RANGE(bench_name, lo, hi, multiplier) __CTF_BENCH_RANGE(bench_name, lo, hi, multiplier)
+#define TEST_RANGE_N __CTF_RANGE_N
+#define TEST_SET_ITEMS(count) __CTF_SET_ITEMS(count)
+#define TEST_SET_BYTES(count) __CTF_SET_BYTES(count)
+#define TEST_EXPECT_COMPLEXITY(order) __CTF_EXPECT_COMPLEXITY(order)
+#define TEST_O_1 __CTF_O_1
+#define TEST_O_LOG_N __CTF_O_LOG_N
+#define TEST_O_N __CTF_O_N
+#define TEST_O_N_LOG_N __CTF_O_N_LOG_N
+#define TEST_O_N_SQUARED __CTF_O_N_SQUARED
+#define TEST_DO_NOT_OPTIMIZE(value) __CTF_DO_NOT_OPTIMIZE(value)
+/* Use at file scope to register a test or benchmark into a suite at compile time, no TEST_SUITE_LINK needed */
+#define TEST_REGISTER(suite, test_name) __CTF_REGISTER(suite, test_name)
+/* Declares and registers a test in one go */
+#define TEST_AUTO_MAKE(suite, test_name) __CTF_AUTO_TEST(suite, test_name)
+/* Use to declare a test that is aborted and reported as timed out after ms milliseconds */
+#define TEST_MAKE_TIMEOUT(test_name, ms) __CTF_MAKE_TIMEOUT(test_name, ms)
+/* Use to declare a fixture, setup returns a void * that teardown gets back, both run around every test using it */
+#define TEST_FIXTURE(fixture_name, setup, teardown) __CTF_FIXTURE(fixture_name, setup, teardown)
+/* Use to declare a test that runs between the setup and teardown of fixture_name */
+#define TEST_MAKE_FIXTURE(test_name, fixture_name) __CTF_MAKE_FIXTURE(test_name, fixture_name)
+/* Use in TEST_MAKE_FIXTURE, what the setup of the fixture returned */
+#define TEST_FIXTURE_DATA __ctf_fixture_data
+/* Use to declare a test that runs once per element of the static array cases, each reported as test_name[i] */
+#define TEST_MAKE_PARAM(test_name, type, cases) __CTF_MAKE_PARAM(test_name, type, cases)
+/* Use in TEST_MAKE_PARAM, the current element and its index */
+#define TEST_PARAM (*__ctf_param)
+#define TEST_PARAM_INDEX __ctf_param_index
+/* Use to declare a test whose body runs on nthreads pinned threads started together, 0 for one per CPU */
+#define TEST_MAKE_THREADED(test_name, nthreads) __CTF_MAKE_THREADED(test_name, nthreads)
+/* Use in TEST_MAKE_THREADED, the running thread's index, the number of threads, ops to count toward the ops/s report
+   and whether another thread failed already */
+#define TEST_THREAD_INDEX (__ctf_thread->index)
+#define TEST_THREAD_COUNT (__ctf_thread->count)
+#define TEST_THREAD_OPS(count) __CTF_THREAD_OPS(count)
+#define TEST_THREAD_STOPPED() __CTF_THREAD_STOPPED(__ctf_thread)
+/* Use to declare a property checked against random inputs from the given TEST_GEN_* generators */
+#define TEST_PROPERTY(prop_name, ...) __CTF_PROPERTY(prop_name, __VA_ARGS__)
+#define TEST_GEN_INT(lo, hi) __CTF_GEN_INT(lo, hi)
+#define TEST_GEN_BOOL() __CTF_GEN_INT(0, 1)
+#define TEST_GEN_DOUBLE(lo, hi) __CTF_GEN_DOUBLE(lo, hi)
+/* Use in TEST_PROPERTY, the generated value of the i-th generator */
+#define TEST_ARG_INT(index) (__ctf_prop_args[index].i)
+#define TEST_ARG_BOOL(index) (__ctf_prop_args[index].i != 0)
+#define TEST_ARG_DOUBLE(index) (__ctf_prop_args[index].d)
 /* Use in CTF_TEST */
 #define TEST_PASS() __CTF_PASS()
 #define TEST_FAIL() __CTF_FAIL()
@@ -80,6 +334,20 @@
 #define TEST_ASSERT_LOG(cond, ...) __CTF_ASSERT_LOG(cond, __VA_ARGS__)
 #define TEST_ASSERT_CLEAN(cond, ...) __CTF_ASSERT_CLEAN(cond, __VA_ARGS__)
 #define TEST_ASSERT_CLEAN_LOG(cond, clean_func, ...) __CTF_ASSERT_CLEAN_LOG(cond, clean_func, __VA_ARGS__)
+/* Compare whole buffers and report the first mismatch with a hexdump around it */
+#define TEST_ASSERT_MEM_EQ(a, b, size) __CTF_ASSERT_MEM_EQ(a, b, size)
+#define TEST_ASSERT_ARRAY_EQ(type, a, b, count) __CTF_ASSERT_ARRAY_EQ(type, a, b, count)
+#define TEST_ASSERT_ARRAY_NEAR(type, a, b, count, eps) __CTF_ASSERT_ARRAY_NEAR(type, a, b, count, eps)
+/* Timeline events for --trace, a span lasts until the end of the enclosing scope */
+#define TEST_SPAN(name) __CTF_SPAN(name)
+#define TEST_COUNTER(name, value) __CTF_COUNTER(name, value)
+/* Scratch memory that lives until the end of the test, no need to free it */
+#define TEST_ALLOC(size) __CTF_ARENA_ALLOC(size)
+#define TEST_ARENA_RESET() __CTF_ARENA_RESET()
+/* Allocation budgets for the test so far, need CTF_ALLOC_TRACKING */
+#define TEST_ASSERT_MAX_ALLOCS(n) __CTF_ASSERT_MAX_ALLOCS(n)
+#define TEST_ASSERT_MAX_BYTES(n) __CTF_ASSERT_MAX_BYTES(n)
+#define TEST_ASSERT_NO_LEAKS() __CTF_ASSERT_NO_LEAKS()
 /* Wrap clean_func input of CTF_ASSERT_CLEAN_LOG*/
 #define TEST_CLEAN_FUNC(...) __CTF_CLEAN_FUNC(__VA_ARGS__)
 #define TEST_CODE(...) __CTF_CODE(__VA_ARGS__)
@@ -88,11 +356,22 @@
 #define TEST_SUITE(name, ...) __CTF_SUITE(name, __VA_ARGS__)
 #define TEST_SUITE_INIT(name) __CTF_SUITE_INIT(name)
 #define TEST_SUITE_MAKE(name) __CTF_SUITE_MAKE(name)
+/* Use to define hooks run once before and after the selected tests of a suite, they end like a test */
+#define TEST_SUITE_SETUP(name) __CTF_SUITE_SETUP(name)
+#define TEST_SUITE_TEARDOWN(name) __CTF_SUITE_TEARDOWN(name)
 /* Use in CTF_SUITE or in CTF_SUITE_MAKE */
 #define TEST_SUITE_LINK(__suite, test) __CTF_SUITE_LINK(__suite, test)
+#define TEST_SUITE_LINK_SETUP(name) __CTF_SUITE_LINK_SETUP(name)
+#define TEST_SUITE_LINK_TEARDOWN(name) __CTF_SUITE_LINK_TEARDOWN(name)
 #define TEST_SUITE_END(name) __CTF_SUITE_END(name)
 /* Use in main function */
 #define TEST_SUITE_RUN(name) __CTF_SUITE_RUN(name)
+/* Adds a __CTF_Reporter that receives every suite and test event */
+#define TEST_REPORTER_ADD(reporter) __CTF_REPORTER_ADD(reporter)
+/* Runs every test registered with TEST_REGISTER/TEST_AUTO_MAKE */
+#define TEST_RUN_REGISTERED() __CTF_RUN_REGISTERED()
+/* Runs every suite made with TEST_SUITE/TEST_SUITE_MAKE in any translation unit */
+#define TEST_RUN_SUITES() __CTF_RUN_SUITES()
 #define TEST_PROCESS_INIT() __CTF_PROCESS_INIT()
 #define TEST_PROCESS_EXIT() __CTF_PROCESS_EXIT()
 /* Misc */
@@ -101,8 +380,6 @@
 #define TEST_FAIL_VALUE __CTF_FAIL_VALUE
 #endif
 
-static char *__CTF_LOG_FILE_NAME = "ctf.log";
-
 /**
  * @brief Takes the same input as printf. The user does not need newlines at the end of their format strings or messages.
  *
@@ -117,7 +394,195 @@ static char *__CTF_LOG_FILE_NAME = "ctf.log";
  *
  * @return call __CTF_PASS() or __CTF_FAIL() or return __CTF_PASS_VALUE or !TEST_PASS_VALUE
  */
-#define __CTF_MAKE(test_name) int test_name##_func()
+#define __CTF_MAKE(test_name)      \
+    __CTF_AUTO_REGISTER(test_name) \
+    int test_name##_func()
+
+/**
+ * @brief Registers test_name into the suite named by CTF_AUTO_SUITE when CTF_AUTO_REGISTER is defined, expands to
+ * nothing otherwise. Every macro that defines a test starts with it.
+ *
+ */
+#ifndef CTF_AUTO_REGISTER
+#define __CTF_AUTO_REGISTER(test_name)
+#else
+#ifndef CTF_AUTO_SUITE
+#define CTF_AUTO_SUITE "Registered"
+#endif
+#define __CTF_AUTO_REGISTER(test_name) __CTF_REGISTER_NAMED_IMPL(CTF_AUTO_SUITE, test_name);
+#endif
+
+/**
+ * @brief Registers an already declared test or benchmark into suite at compile time.
+ *
+ * @note Define CTF_AUTO_REGISTER before including to make every test, property and benchmark register itself into the suite named by the string CTF_AUTO_SUITE.
+ */
+#define __CTF_REGISTER(suite, test_name) __CTF_REGISTER_NAMED_IMPL(#suite, test_name)
+
+#define __CTF_AUTO_TEST(suite, test_name) \
+    __CTF_REGISTER(suite, test_name);     \
+    int test_name##_func()
+
+/**
+ * @brief Like __CTF_MAKE but the test gets its own timeout, overriding --timeout.
+ *
+ */
+#define __CTF_MAKE_TIMEOUT(test_name, ms)          \
+    __CTF_AUTO_REGISTER(test_name)                 \
+    static int test_name##_timed_func();           \
+    int test_name##_func()                         \
+    {                                              \
+        __CTF_WATCH_ARM(ms);                       \
+        return test_name##_timed_func();           \
+    }                                              \
+    static int test_name##_timed_func()
+
+/**
+ * @brief Like __CTF_MAKE but the body runs between the setup and the teardown of fixture_name.
+ *
+ */
+#define __CTF_MAKE_FIXTURE(test_name, fixture_name)                                   \
+    __CTF_AUTO_REGISTER(test_name)                                                    \
+    static int test_name##_fixture_body();                                            \
+    int test_name##_func()                                                            \
+    {                                                                                 \
+        return __CTF_FIXTURE_RUN(&fixture_name##_fixture, test_name##_fixture_body);  \
+    }                                                                                 \
+    static int test_name##_fixture_body()
+
+#define __CTF_FIXTURE(fixture_name, setup, teardown) \
+    static const __CTF_Fixture fixture_name##_fixture = {#fixture_name, setup, teardown}
+
+/**
+ * @brief Like __CTF_MAKE but the body runs once per element of cases, a static array of type, reached through __ctf_param.
+ *
+ * @note Cases run back to back in one call of the test function, only failing cases get their own output on the console.
+ */
+#define __CTF_MAKE_PARAM(test_name, type, cases)                                                                  \
+    __CTF_AUTO_REGISTER(test_name)                                                                                \
+    static int test_name##_param_body(const type *__ctf_param, __CTF_MAYBE_UNUSED size_t __ctf_param_index);      \
+    static int test_name##_param_case(size_t index)                                                               \
+    {                                                                                                             \
+        return test_name##_param_body(&(cases)[index], index);                                                    \
+    }                                                                                                             \
+    int test_name##_func()                                                                                        \
+    {                                                                                                             \
+        return __CTF_PARAM_RUN(#test_name, test_name##_param_case, sizeof(cases) / sizeof((cases)[0]));           \
+    }                                                                                                             \
+    static int test_name##_param_body(const type *__ctf_param, __CTF_MAYBE_UNUSED size_t __ctf_param_index)
+
+/**
+ * @brief Like __CTF_MAKE but the body runs on nthreads threads at once, each reaching its own __CTF_Thread through
+ * __ctf_thread.
+ *
+ * @note An assert fails the thread it runs on, the test fails if any thread did.
+ */
+#define __CTF_MAKE_THREADED(test_name, nthreads)                                    \
+    __CTF_AUTO_REGISTER(test_name)                                                  \
+    static int test_name##_threaded_body(__CTF_Thread *__ctf_thread);               \
+    int test_name##_func()                                                          \
+    {                                                                               \
+        return __CTF_THREADED_RUN(#test_name, test_name##_threaded_body, nthreads); \
+    }                                                                               \
+    static int test_name##_threaded_body(__CTF_MAYBE_UNUSED __CTF_Thread *__ctf_thread)
+
+#define __CTF_THREAD_OPS(count) (__ctf_thread->ops += (unsigned long long)(count))
+
+/**
+ * @brief Used to define a property. The body runs against --prop-runs random inputs, one per generator, and ends like a test.
+ *
+ * @note The body is called many times and must not depend on state left by earlier calls, the failing input is shrunk by rerunning it.
+ */
+#define __CTF_PROPERTY(prop_name, ...)                                                                             \
+    __CTF_AUTO_REGISTER(prop_name)                                                                                 \
+    static int prop_name##_prop_body(const __CTF_Prop_Value *__ctf_prop_args);                                     \
+    static const __CTF_Generator prop_name##_generators[] = {__VA_ARGS__};                                         \
+    int prop_name##_func()                                                                                         \
+    {                                                                                                              \
+        return __CTF_PROPERTY_RUN(#prop_name, prop_name##_prop_body, prop_name##_generators,                       \
+                                  (int)(sizeof(prop_name##_generators) / sizeof(prop_name##_generators[0])));       \
+    }                                                                                                              \
+    static int prop_name##_prop_body(__CTF_MAYBE_UNUSED const __CTF_Prop_Value *__ctf_prop_args)
+
+#define __CTF_GEN_INT(lo, hi) {__CTF_GEN_KIND_INT, (long long)(lo), (long long)(hi), 0, 0}
+#define __CTF_GEN_DOUBLE(lo, hi) {__CTF_GEN_KIND_DOUBLE, 0, 0, (double)(lo), (double)(hi)}
+
+/**
+ * @brief Used to define a benchmark. The body runs setup, then the code to measure inside __CTF_BENCH_LOOP, and ends like a test.
+ *
+ * @note The body is called many times while calibrating, keep anything outside the loop cheap and side effect free.
+ */
+#define __CTF_BENCH(bench_name)                                       \
+    __CTF_AUTO_REGISTER(bench_name)                                   \
+    static int bench_name##_bench_body(__CTF_Bench *__ctf_bench);     \
+    int bench_name##_func()                                           \
+    {                                                                 \
+        return __CTF_BENCH_RUN(#bench_name, bench_name##_bench_body); \
+    }                                                                 \
+    static int bench_name##_bench_body(__CTF_Bench *__ctf_bench)
+
+/**
+ * @brief Used to define a benchmark measured at every N from lo to hi, multiplying by multiplier, read N with
+ * __CTF_RANGE_N.
+ *
+ */
+#define __CTF_BENCH_RANGE(bench_name, lo, hi, multiplier)                                       \
+    __CTF_AUTO_REGISTER(bench_name)                                                             \
+    static int bench_name##_bench_body(__CTF_Bench *__ctf_bench);                               \
+    int bench_name##_func()                                                                     \
+    {                                                                                           \
+        return __CTF_BENCH_RANGE_RUN(#bench_name, bench_name##_bench_body, lo, hi, multiplier); \
+    }                                                                                           \
+    static int bench_name##_bench_body(__CTF_Bench *__ctf_bench)
+
+#define __CTF_RANGE_N (__ctf_bench->n)
+#define __CTF_SET_ITEMS(count) (__ctf_bench->items = (unsigned long long)(count))
+#define __CTF_SET_BYTES(count) (__ctf_bench->bytes = (unsigned long long)(count))
+#define __CTF_EXPECT_COMPLEXITY(order) (__ctf_bench->expected = (order))
+
+/**
+ * @brief Repeats the following statement or block for the calibrated number of iterations and times it.
+ *
+ */
+#define __CTF_BENCH_LOOP \
+    for (__CTF_BENCH_BEGIN(__ctf_bench); __ctf_bench->remaining-- > 0 || __CTF_BENCH_END(__ctf_bench);)
+
+#define __CTF_CONCAT_IMPL(a, b) a##b
+#define __CTF_CONCAT(a, b) __CTF_CONCAT_IMPL(a, b)
+
+/**
+ * @brief Records the rest of the enclosing scope as a region named name with --trace.
+ *
+ * @note Needs the cleanup attribute of GCC and Clang, elsewhere it records nothing.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define __CTF_SPAN(name)                                                                                  \
+    __attribute__((cleanup(__CTF_TRACE_SPAN_END))) __CTF_Trace_Span __CTF_CONCAT(__ctf_span_, __LINE__) = \
+        {name, __ctf_trace ? __CTF_NOW_NS() : 0}
+#else
+#define __CTF_SPAN(name) (void)(name)
+#endif
+
+/**
+ * @brief Adds a sample of the counter name to the timeline with --trace.
+ *
+ */
+#define __CTF_COUNTER(name, value) (__ctf_trace ? __CTF_TRACE_COUNTER(name, (long long)(value)) : (void)0)
+
+/**
+ * @brief Keeps the compiler from optimizing away a value computed in a benchmark.
+ *
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define __CTF_DO_NOT_OPTIMIZE(value) __asm__ __volatile__("" : : "r,m"(value) : "memory")
+#else
+#define __CTF_DO_NOT_OPTIMIZE(value)            \
+    do                                          \
+    {                                           \
+        static volatile int __ctf_sink;         \
+        __ctf_sink = (int)(size_t)&(value);     \
+    } while (0)
+#endif
 
 #define __CTF_PASS_VALUE 1
 
@@ -209,6 +674,70 @@ static char *__CTF_LOG_FILE_NAME = "ctf.log";
         }                                             \
     } while (0)
 
+/**
+ * @brief Fails the test if the size bytes at a and b differ.
+ *
+ */
+#define __CTF_ASSERT_MEM_EQ(a, b, size) __CTF_ASSERT_BULK(#a, #b, a, b, size, 1, __CTF_VALUE_BYTES, __CTF_MISMATCH_BYTES(__ctf_a, __ctf_b, __ctf_size), 0)
+
+/**
+ * @brief Fails the test if two arrays of count elements of type differ, compared bytewise, so use __CTF_ASSERT_ARRAY_NEAR for floating point.
+ *
+ */
+#define __CTF_ASSERT_ARRAY_EQ(type, a, b, count) \
+    __CTF_ASSERT_BULK(#a, #b, a, b, (size_t)(count) * sizeof(type), sizeof(type), __CTF_VALUE_KIND(type), __CTF_MISMATCH_BYTES(__ctf_a, __ctf_b, __ctf_size), 0)
+
+/**
+ * @brief Fails the test if an element of two float or double arrays differs by more than eps. NaN never matches.
+ *
+ */
+#define __CTF_ASSERT_ARRAY_NEAR(type, a, b, count, eps)                                                             \
+    __CTF_ASSERT_BULK(#a, #b, a, b, (size_t)(count) * sizeof(type), sizeof(type), __CTF_VALUE_KIND(type),             \
+                      __CTF_MISMATCH_NEAR(type, __ctf_a, __ctf_b, __ctf_size, eps), eps)
+
+/* The mismatch expression gives the byte offset of the first differing element, size if there is none */
+#define __CTF_ASSERT_BULK(a_text, b_text, a, b, size, element_size, kind, mismatch, eps)                                      \
+    do                                                                                                                  \
+    {                                                                                                                   \
+        const void *__ctf_a = (a), *__ctf_b = (b);                                                                      \
+        size_t __ctf_size = (size), __ctf_at = (mismatch);                                                              \
+        if (__CTF_UNLIKELY(__ctf_at < __ctf_size))                                                                      \
+        {                                                                                                               \
+            __CTF_BULK_FAIL(a_text, b_text, __ctf_a, __ctf_b, __ctf_size, __ctf_at, element_size, kind, (double)(eps), __FILE__, __LINE__); \
+            return __CTF_FAIL_VALUE;                                                                                    \
+        }                                                                                                               \
+    } while (0)
+
+/**
+ * @brief Fails the test if it has made more than n allocations so far. Always passes without CTF_ALLOC_TRACKING.
+ *
+ */
+#define __CTF_ASSERT_MAX_ALLOCS(n) __CTF_ASSERT_ALLOC_BUDGET("allocation count", __ctf_alloc_stats.count, n)
+
+/**
+ * @brief Fails the test if it has allocated more than n bytes so far.
+ *
+ */
+#define __CTF_ASSERT_MAX_BYTES(n) __CTF_ASSERT_ALLOC_BUDGET("allocated bytes", __ctf_alloc_stats.bytes, n)
+
+/**
+ * @brief Fails the test if memory it allocated is still live.
+ *
+ */
+#define __CTF_ASSERT_NO_LEAKS() __CTF_ASSERT_ALLOC_BUDGET("leaked bytes", __CTF_ALLOC_LEAKED(&__ctf_alloc_stats), 0)
+
+#define __CTF_ASSERT_ALLOC_BUDGET(what, used, limit)                                                                            \
+    do                                                                                                                          \
+    {                                                                                                                           \
+        unsigned long long __ctf_used = (used), __ctf_limit = (limit);                                                          \
+        if (__ctf_used > __ctf_limit)                                                                                           \
+        {                                                                                                                       \
+            __CTF_LOG("%sAssertion failed: %s %llu exceeds the budget of %llu in test \"%s\" (%s:%d).%s", __CTF_ANSI_RED, what, \
+                      __ctf_used, __ctf_limit, __ctf_current_test_name, __FILE__, __LINE__, __CTF_ANSI_RESET);                  \
+            __CTF_FAIL();                                                                                                       \
+        }                                                                                                                       \
+    } while (0)
+
 /**
  * @brief Creates a test suite with the given name. This is the preferred, but not required, way to create a test suite.
  *
@@ -225,6 +754,15 @@ static char *__CTF_LOG_FILE_NAME = "ctf.log";
  */
 #define __CTF_SUITE_LINK(__suite, test) __CTF_SUITE_LINK_IMPL(&__suite##_suite, test##_func, #test)
 
+/**
+ * @brief Used to define the hooks of a suite, link them with __CTF_SUITE_LINK_SETUP and __CTF_SUITE_LINK_TEARDOWN.
+ *
+ */
+#define __CTF_SUITE_SETUP(name) static int name##_suite_setup_func()
+#define __CTF_SUITE_TEARDOWN(name) static int name##_suite_teardown_func()
+#define __CTF_SUITE_LINK_SETUP(name) ((name##_suite).setup = name##_suite_setup_func)
+#define __CTF_SUITE_LINK_TEARDOWN(name) ((name##_suite).teardown = name##_suite_teardown_func)
+
 /**
  * @brief Call this macro to run a test suite.
  *
@@ -239,6 +777,18 @@ static char *__CTF_LOG_FILE_NAME = "ctf.log";
 
 #define __CTF_PROCESS_EXIT() __CTF_PROCESS_EXIT_IMPL()
 
+/**
+ * @brief Call this macro to run all statically registered tests.
+ *
+ */
+#define __CTF_RUN_REGISTERED() __CTF_RUN_REGISTERED_IMPL()
+
+/**
+ * @brief Call this macro to run every suite of every translation unit.
+ *
+ */
+#define __CTF_RUN_SUITES() __CTF_RUN_SUITES_IMPL()
+
 /*
     If you use __CTF_SUITE you dont need to use the following macros.
 */
@@ -273,6 +823,7 @@ typedef struct
 {
     int (*test_func)();
     const char *test_name;
+    const char *suite_name;
 } __CTF_Test;
 
 typedef struct
@@ -281,94 +832,146 @@ typedef struct
     int count;
     int capacity;
     const char *name;
+    /* Hooks run once around the selected tests, NULL if the suite has none */
+    int (*setup)();
+    int (*teardown)();
 } __CTF_Test_Suite;
 
-static char *__ctf_current_test_suite_name = NULL;
-static char *__ctf_current_test_name = NULL;
+typedef struct
+{
+    const char *name;
+    void *(*setup)(void);
+    void (*teardown)(void *data);
+} __CTF_Fixture;
 
-static unsigned int __ctf_suites_ran = 0;
+/* One thread of a CTF_TEST_THREADED body, see Threaded tests */
+typedef struct
+{
+    int index;
+    int count;
+    unsigned long long ops;
+    /* The __CTF_Threaded_Run the thread belongs to */
+    void *run;
+    int status;
+    unsigned long long start_ns;
+    unsigned long long end_ns;
+    /* "test#index" for assertion messages, it also keeps the ops of neighbouring threads off one cache line */
+    char name[128];
+} __CTF_Thread;
 
-static jmp_buf __ctf_env;
-static volatile sig_atomic_t __signal_caught = 0;
+/* A generator of CTF_PROPERTY draws integers in [lo, hi] or doubles in [dlo, dhi] */
+#define __CTF_GEN_KIND_INT 0
+#define __CTF_GEN_KIND_DOUBLE 1
 
-static FILE *__ctf_log_file = NULL;
+typedef struct
+{
+    int kind;
+    long long lo;
+    long long hi;
+    double dlo;
+    double dhi;
+} __CTF_Generator;
 
-static clock_t __ctf_process_start_time = -1;
+typedef union
+{
+    long long i;
+    double d;
+} __CTF_Prop_Value;
 
-/**
- * @brief Set to true to ask the user if they want to continue testing after a signal is caught or quit. If false we will return to testing. If true we will defer to the user.
- *
- * @note When enabled, if you are running the test program from a debugger it may cause the program to hang.
- */
-static bool __ctf_handle_signal_ask_user = false;
+#define __CTF_TEST_PASSED 0
+#define __CTF_TEST_FAILED 1
+#define __CTF_TEST_SIGNALED 2
+#define __CTF_TEST_TIMED_OUT 3
 
-static bool __ctf_try_use_colors = true;
+/* Heap activity of the test thread while a test runs, live is signed since a test may free older memory */
+typedef struct
+{
+    unsigned long long count;
+    unsigned long long bytes;
+    long long live;
+    long long peak;
+} __CTF_Alloc_Stats;
 
-static bool __ctf_use_signal_handlers = true;
+#define __CTF_ALLOC_LEAKED(stats) ((stats)->live > 0 ? (unsigned long long)(stats)->live : 0ULL)
 
-/* Meant to be crossplatform */
-static bool __CTF_ANSI_COLOR_SUPPORT()
+/* Counters around the test function with --perf, the hardware ones are only valid if hardware is set */
+typedef struct
 {
-    if (!__ctf_try_use_colors)
-    {
-        return false;
-    }
-    static bool ran_before = false, supports_colors = false;
-    if (ran_before)
-    {
-        return supports_colors;
-    }
-    ran_before = true;
-    char *term = getenv("TERM");
-    if (term != NULL &&
-        (strstr(term, "xterm") != NULL || strstr(term, "color") != NULL ||
-         strstr(term, "ansi") != NULL || strstr(term, "cygwin") != NULL ||
-         strstr(term, "linux") != NULL || strstr(term, "screen") != NULL ||
-         strstr(term, "tmux") != NULL || strstr(term, "vt100") != NULL ||
-         strstr(term, "rxvt") != NULL || strstr(term, "konsole") != NULL ||
-         strstr(term, "gnome") != NULL || strstr(term, "eterm") != NULL ||
-         strstr(term, "vscode") != NULL))
-    {
-        supports_colors = true;
-        return true;
-    }
-    char *colorterm = getenv("COLORTERM");
-    if (colorterm != NULL &&
-        (strstr(colorterm, "truecolor") != NULL || strstr(colorterm, "24bit") != NULL))
-    {
-        supports_colors = true;
-        return true;
-    }
-    supports_colors = false;
-    return false;
-}
+    bool hardware;
+    unsigned long long cycles;
+    unsigned long long instructions;
+    unsigned long long cache_misses;
+    unsigned long long branch_misses;
+    unsigned long long page_faults;
+    unsigned long long context_switches;
+    unsigned long long peak_rss_kb;
+} __CTF_Perf_Stats;
 
-static const char *__CTF_ANSI_COLOR(const char *color)
+typedef struct
 {
-    if (!__ctf_try_use_colors)
-        return "";
-    static signed char supported = -1;
-    if (supported == -1)
-        supported = __CTF_ANSI_COLOR_SUPPORT();
-    return supported ? color : "";
-}
+    int status;
+    int signal;
+    double elapsed;
+    __CTF_Alloc_Stats alloc;
+    __CTF_Perf_Stats perf;
+    /* Verdict against --compare-baseline, change of the median in percent and the p value of the test */
+    int baseline;
+    double baseline_change;
+    double baseline_p;
+    /* Number of cases and passing cases of a parametrized test, 0 for a plain test */
+    long cases;
+    long cases_passed;
+    /* Index in the table when the result is for a single case of a parametrized test, -1 otherwise */
+    long case_index;
+} __CTF_Test_Result;
 
-static bool __CTF_ASK_USER()
+typedef struct
 {
-    fflush(stdin);
-    char c = 0;
-    while (c != 'y' && c != 'n' && c != 'Y' && c != 'N' && c != EOF)
-    {
-        printf("[Y/y|N/n]: ");
-        c = getchar();
-        fflush(stdin);
-    }
-    if (c == EOF || c == 'n' || c == 'N')
-    {
-        return false;
-    }
-    return true;
-}
+    int total;
+    int passed;
+    int timed_out;
+    int regressed;
+} __CTF_Suite_Summary;
+
+/* An open CTF_SPAN, see Tracing */
+typedef struct
+{
+    const char *name;
+    unsigned long long start;
+} __CTF_Trace_Span;
+
+/* State of a running benchmark, see Benchmarks */
+typedef struct
+{
+    unsigned long long iterations;
+    unsigned long long remaining;
+    unsigned long long start;
+    unsigned long long elapsed_ns;
+    bool looped;
+    /* Input size of the current CTF_BENCH_RANGE step */
+    long long n;
+    /* Set by the body, items and bytes processed per iteration and the complexity it should have */
+    unsigned long long items;
+    unsigned long long bytes;
+    int expected;
+} __CTF_Bench;
+
+/* Receives every suite and test event, see Reporters */
+typedef struct
+{
+    void (*suite_start)(const char *suite);
+    void (*test_start)(const char *suite, const char *test);
+    void (*test_end)(const char *suite, const char *test, const __CTF_Test_Result *result);
+    void (*suite_end)(const char *suite, const __CTF_Suite_Summary *summary, double elapsed);
+    void (*process_exit)(unsigned int suites_ran, double elapsed);
+} __CTF_Reporter;
+
+/* Entry of the suite registry, see CTF_RUN_SUITES */
+typedef struct
+{
+    const char *name;
+    void (*suite_func)();
+} __CTF_Suite_Entry;
 
 #define __CTF_FAIL_TEXT()                                                                       \
     __CTF_LOG("\n\t%sFail in Suite:%s\"%s\"%s, Test:%s\"%s\"%s:%s\n\t\tfile: %s\n\t\tline: %d", \
@@ -378,199 +981,6087 @@ static bool __CTF_ASK_USER()
     __CTF_LOG("\n\t%sAssertion failed:%s\n\t\tcond: %s", \
               __CTF_ANSI_RED, __CTF_ANSI_RESET, #cond)
 
-#define __CTF_LOG_ARGS_COLOR(suite, test) "%s[LOG%s%s%s%s]%s ", __CTF_ANSI_YELLOW, suite ? "/" : "", suite ? __ctf_current_test_suite_name : "", test ? "/" : "", test ? __ctf_current_test_name : "", __CTF_ANSI_RESET
-#define __CTF_LOG_ARGS(suite, test) "[LOG%s%s%s%s] ", suite ? "/" : "", suite ? __ctf_current_test_suite_name : "", test ? "/" : "", test ? __ctf_current_test_name : ""
-
-static void __CTF_LOG_FLAIR_FILE(FILE *file, bool suite, bool test)
-{
-    fprintf(file, __CTF_LOG_ARGS(suite, test));
-}
-static void __CTF_LOG_FLAIR(bool suite, bool test)
-{
-    printf(__CTF_LOG_ARGS_COLOR(suite, test));
-}
 /**
  * @brief Takes a filename rather than FILE* because we expect a critial error to occur and always want to ensure that the log is written.
  *
- * @note If __CTF_PROCESS_INIT was called then we will use already opened __ctf_log_file. This enables faster logging.
- *
- */
-#define __CTF_LOG_IMPL(filename, ...)                                        \
-    do                                                                       \
-    {                                                                        \
-        bool suite = __ctf_current_test_suite_name != NULL;                  \
-        bool test = __ctf_current_test_name != NULL;                         \
-        __CTF_LOG_FLAIR(suite, test);                                        \
-        printf(__VA_ARGS__);                                                 \
-        putchar('\n');                                                       \
-        FILE *file = __ctf_log_file ? __ctf_log_file : fopen(filename, "a"); \
-        bool old_use_colors = __ctf_try_use_colors;                          \
-        __ctf_try_use_colors = false;                                        \
-        if (file)                                                            \
-        {                                                                    \
-            __CTF_LOG_FLAIR_FILE(file, suite, test);                         \
-            fprintf(file, __VA_ARGS__);                                      \
-            fputc('\n', file);                                               \
-            if (!__ctf_log_file)                                             \
-                fclose(file);                                                \
-        }                                                                    \
-        __ctf_try_use_colors = old_use_colors;                               \
-    } while (0)
+ * @note If __CTF_PROCESS_INIT was called then we will use already opened __ctf_log_file, otherwise filename is opened once and kept open.
+ *
+ */
+#define __CTF_LOG_IMPL(filename, ...) __CTF_LOG_WRITE(filename, __VA_ARGS__)
 
-static void __CTF_PROCESS_EXIT_IMPL(void)
-{
-    __CTF_LOG("Testing complete. %d suite(s) ran.", __ctf_suites_ran);
-    clock_t end_time = clock();
-    float runtime = (double)(end_time - __ctf_process_start_time) / CLOCKS_PER_SEC;
-    __CTF_LOG("Testing process completed in %fs.", __ctf_process_start_time != -1 ? runtime : -1.0f);
-    if (__ctf_log_file)
-    {
+/* Element kinds of the bulk assertions */
+#define __CTF_VALUE_BYTES 0
+#define __CTF_VALUE_SIGNED 1
+#define __CTF_VALUE_UNSIGNED 2
+#define __CTF_VALUE_FLOAT 3
+#define __CTF_VALUE_DOUBLE 4
+
+/* How to print an element of type, anything that isn't a plain number is shown as bytes */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define __CTF_VALUE_KIND(type)                                                   \
+    _Generic(*(type *)0,                                                         \
+        char: ((char)-1 < 0 ? __CTF_VALUE_SIGNED : __CTF_VALUE_UNSIGNED),        \
+        signed char: __CTF_VALUE_SIGNED,                                         \
+        short: __CTF_VALUE_SIGNED,                                               \
+        int: __CTF_VALUE_SIGNED,                                                 \
+        long: __CTF_VALUE_SIGNED,                                                \
+        long long: __CTF_VALUE_SIGNED,                                           \
+        _Bool: __CTF_VALUE_UNSIGNED,                                             \
+        unsigned char: __CTF_VALUE_UNSIGNED,                                     \
+        unsigned short: __CTF_VALUE_UNSIGNED,                                    \
+        unsigned int: __CTF_VALUE_UNSIGNED,                                      \
+        unsigned long: __CTF_VALUE_UNSIGNED,                                     \
+        unsigned long long: __CTF_VALUE_UNSIGNED,                                \
+        float: __CTF_VALUE_FLOAT,                                                \
+        double: __CTF_VALUE_DOUBLE,                                              \
+        default: __CTF_VALUE_BYTES)
+
+/* Comparison kernel of __CTF_ASSERT_ARRAY_NEAR, there is no default so any type but float and double fails to compile */
+#define __CTF_MISMATCH_NEAR(type, a, b, size, eps)                  \
+    _Generic(*(type *)0,                                            \
+        float: __CTF_MISMATCH_FLOAT(a, b, size, (float)(eps)),      \
+        double: __CTF_MISMATCH_DOUBLE(a, b, size, (double)(eps)))
+#else
+#define __CTF_VALUE_KIND(type) __CTF_VALUE_BYTES
+/* Only the size can be told apart before C11, integer types would be compared as floating point */
+#define __CTF_MISMATCH_NEAR(type, a, b, size, eps) \
+    (sizeof(type) == sizeof(float) ? __CTF_MISMATCH_FLOAT(a, b, size, (float)(eps)) : __CTF_MISMATCH_DOUBLE(a, b, size, (double)(eps)))
+#endif
+
+/* Orders for CTF_EXPECT_COMPLEXITY, in the order CTF_BENCH_RANGE fits them */
+#define __CTF_O_1 0
+#define __CTF_O_LOG_N 1
+#define __CTF_O_N 2
+#define __CTF_O_N_LOG_N 3
+#define __CTF_O_N_SQUARED 4
+
+#define __CTF_SUITE_INIT_IMPL(name)                                                                                             \
+    __ctf_current_test_suite_name = (char *)#name;                                                                              \
+    int __CTF_SUITE_INIT_IMPL_i = 22 + ((sizeof(#name) / sizeof(char)) - 3), __CTF_SUITE_INIT_IMPL_j = __CTF_SUITE_INIT_IMPL_i; \
+    if (!__ctf_list_only && !__ctf_quiet)                                                                                       \
+    {                                                                                                                           \
+        __CTF_PRINT_RULE('+', __CTF_SUITE_INIT_IMPL_i);                                                                         \
+        __CTF_LOG_TIME();                                                                                                       \
+    }
+
+#define __CTF_SUITE_IMPL(name, ...)  \
+    __CTF_SUITE_MAKE(name)           \
+    {                                \
+        __CTF_SUITE_INIT_IMPL(name); \
+        __CTF_BLOCK(__VA_ARGS__);    \
+        __CTF_SUITE_END(name);       \
+    }
+
+#define __CTF_LOG_TIME_IMPL()                                    \
+    {                                                            \
+        time_t t;                                                \
+        time(&t);                                                \
+        char buff[70];                                           \
+        if (strftime(buff, sizeof buff, "%A %c", localtime(&t))) \
+            __CTF_LOG("%s", buff);                               \
+        else                                                     \
+            __CTF_LOG("Could not get date and time info.");      \
+    }
+
+#define __CTF_SUITE_RUN_IMPL(name) __CTF_RUN_SUITE(#name, name##_suite_func)
+
+#define __CTF_SUITE_MAKE_IMPL(__name)                                                                                \
+    static __CTF_Test_Suite __name##_suite = {                                                                       \
+        NULL,                                                                                                        \
+        0,                                                                                                           \
+        0,                                                                                                           \
+        #__name,                                                                                                     \
+        NULL,                                                                                                        \
+        NULL,                                                                                                        \
+    };                                                                                                               \
+    static void __name##_suite_func();                                                                               \
+    static const __CTF_Suite_Entry __name##_suite_entry __CTF_SUITE_REGISTRY_ENTRY = {#__name, __name##_suite_func}; \
+    static void __name##_suite_func()
+
+#define __CTF_SUITE_END_IMPL(name)                                                                                                 \
+    do                                                                                                                             \
+    {                                                                                                                              \
+        if (__ctf_list_only)                                                                                                       \
+        {                                                                                                                          \
+            __CTF_LIST_TESTS(&(name##_suite));                                                                                     \
+        }                                                                                                                          \
+        else                                                                                                                       \
+        {                                                                                                                          \
+            double test_start_time = __CTF_NOW();                                                                                  \
+            __CTF_SUITE_RUN_TESTS(name##_suite);                                                                                   \
+            double test_runtime_sec = __CTF_NOW() - test_start_time;                                                               \
+            if (!__ctf_quiet)                                                                                                      \
+            {                                                                                                                      \
+                __CTF_LOG("\nTest suite %s\"%s\"%s tests ran for %fs.", __CTF_ANSI_YELLOW, #name, __CTF_ANSI_RESET,                \
+                          test_runtime_sec);                                                                                       \
+                __CTF_PRINT_RULE('-', __CTF_SUITE_INIT_IMPL_j);                                                                    \
+            }                                                                                                                      \
+        }                                                                                                                          \
+        free((name##_suite).tests);                                                                                                \
+        /* Unlinked again, so the suite can be run once more by a repeated pass */                                                 \
+        (name##_suite).tests = NULL;                                                                                               \
+        (name##_suite).count = 0;                                                                                                  \
+        (name##_suite).capacity = 0;                                                                                               \
+        __ctf_current_test_name = NULL;                                                                                            \
+        __ctf_current_test_suite_name = NULL;                                                                                      \
+    } while (0)
+
+/*
+    Static registration.
+
+    CTF_REGISTER places a const __CTF_Test in the "ctf_tests" linker section at compile time, the linker then provides
+    the bounds of the section so the runner can walk every registered test of every translation unit without any
+    CTF_SUITE_LINK call. The runner sorts a copy of the entries by suite name, so a suite's tests run together even
+    when they are registered in several files, and suites run in name order. Order within the section is up to the
+    compiler and linker, so registered tests must not depend on running in declaration order.
+
+    Every suite made with CTF_SUITE or CTF_SUITE_MAKE also places its name and function in the "ctf_suites" section,
+    so CTF_RUN_SUITES runs the suites of all translation units without main having to name them.
+*/
+
+#if defined(__APPLE__) && (defined(__GNUC__) || defined(__clang__))
+#define __CTF_HAS_REGISTRY 1
+#define __CTF_REGISTRY_ENTRY __attribute__((used, section("__DATA,__ctf_tests"), aligned(sizeof(void *))))
+extern const __CTF_Test __ctf_registry_start __asm("section$start$__DATA$__ctf_tests");
+extern const __CTF_Test __ctf_registry_stop __asm("section$end$__DATA$__ctf_tests");
+#define __CTF_REGISTRY_BEGIN (&__ctf_registry_start)
+#define __CTF_REGISTRY_END (&__ctf_registry_stop)
+#define __CTF_SUITE_REGISTRY_ENTRY __attribute__((used, section("__DATA,__ctf_suites"), aligned(sizeof(void *))))
+extern const __CTF_Suite_Entry __ctf_suite_registry_start __asm("section$start$__DATA$__ctf_suites");
+extern const __CTF_Suite_Entry __ctf_suite_registry_stop __asm("section$end$__DATA$__ctf_suites");
+#define __CTF_SUITE_REGISTRY_BEGIN (&__ctf_suite_registry_start)
+#define __CTF_SUITE_REGISTRY_END (&__ctf_suite_registry_stop)
+#elif (defined(__ELF__) || defined(__unix__)) && (defined(__GNUC__) || defined(__clang__))
+#define __CTF_HAS_REGISTRY 1
+/* Explicit alignment stops the compiler from padding entries apart, so the section is a plain array */
+#define __CTF_REGISTRY_ENTRY __attribute__((used, section("ctf_tests"), aligned(sizeof(void *))))
+/* Weak so a binary without any registered test still links */
+extern const __CTF_Test __start_ctf_tests[] __attribute__((weak));
+extern const __CTF_Test __stop_ctf_tests[] __attribute__((weak));
+#define __CTF_REGISTRY_BEGIN (__start_ctf_tests)
+#define __CTF_REGISTRY_END (__stop_ctf_tests)
+#define __CTF_SUITE_REGISTRY_ENTRY __attribute__((used, section("ctf_suites"), aligned(sizeof(void *))))
+extern const __CTF_Suite_Entry __start_ctf_suites[] __attribute__((weak));
+extern const __CTF_Suite_Entry __stop_ctf_suites[] __attribute__((weak));
+#define __CTF_SUITE_REGISTRY_BEGIN (__start_ctf_suites)
+#define __CTF_SUITE_REGISTRY_END (__stop_ctf_suites)
+#else
+#define __CTF_HAS_REGISTRY 0
+#define __CTF_REGISTRY_ENTRY
+#define __CTF_REGISTRY_BEGIN ((const __CTF_Test *)NULL)
+#define __CTF_REGISTRY_END ((const __CTF_Test *)NULL)
+#define __CTF_SUITE_REGISTRY_ENTRY __CTF_MAYBE_UNUSED
+#define __CTF_SUITE_REGISTRY_BEGIN ((const __CTF_Suite_Entry *)NULL)
+#define __CTF_SUITE_REGISTRY_END ((const __CTF_Suite_Entry *)NULL)
+#endif
+
+#define __CTF_REGISTER_NAMED_IMPL(suite_name, test_name)                      \
+    int test_name##_func();                                                   \
+    static const __CTF_Test test_name##_registration __CTF_REGISTRY_ENTRY = { \
+        test_name##_func,                                                     \
+        #test_name,                                                           \
+        suite_name,                                                           \
+    }
+
+
+/*
+    Separate compilation.
+
+    By default every translation unit that includes this header compiles its own private copy of the runtime. Define
+    CTF_SHARED in all of them and CTF_IMPLEMENTATION in exactly one: that one compiles the runtime with external
+    linkage, the others only get the declarations below and the macros above, and every suite of the executable shares
+    one process wide state. Options that change the runtime, like CTF_ALLOC_TRACKING, must be set for the
+    implementation. The declarations need no threads, atomics or intrinsics, so they are also all a C++ translation
+    unit can include.
+*/
+
+#ifdef CTF_SHARED
+#define __CTF_API
+extern char *__CTF_LOG_FILE_NAME;
+extern __CTF_THREAD_LOCAL char *__ctf_current_test_suite_name;
+extern __CTF_THREAD_LOCAL char *__ctf_current_test_name;
+extern __CTF_THREAD_LOCAL __CTF_Alloc_Stats __ctf_alloc_stats;
+extern __CTF_THREAD_LOCAL void *__ctf_fixture_data;
+extern bool __ctf_list_only;
+extern bool __ctf_quiet;
+extern bool __ctf_trace;
+double __CTF_NOW(void);
+unsigned long long __CTF_NOW_NS(void);
+const char *__CTF_ANSI_COLOR(const char *color);
+void __CTF_LOG_WRITE(const char *filename, const char *format, ...) __CTF_PRINTF_FORMAT(2, 3);
+void __CTF_PRINT_RULE(char c, int count);
+void __CTF_WATCH_ARM(unsigned long timeout_ms);
+size_t __CTF_MISMATCH_BYTES(const void *a_ptr, const void *b_ptr, size_t size);
+size_t __CTF_MISMATCH_FLOAT(const void *a_ptr, const void *b_ptr, size_t size, float eps);
+size_t __CTF_MISMATCH_DOUBLE(const void *a_ptr, const void *b_ptr, size_t size, double eps);
+void __CTF_BULK_FAIL(const char *a_text, const char *b_text, const void *a_ptr, const void *b_ptr, size_t size, size_t at,
+                     size_t element_size, int kind, double eps, const char *file, int line);
+void *__CTF_ARENA_ALLOC(size_t size);
+void __CTF_ARENA_RESET(void);
+void __CTF_TRACE_COUNTER(const char *name, long long value);
+void __CTF_TRACE_SPAN_END(__CTF_Trace_Span *span);
+int __CTF_FIXTURE_RUN(const __CTF_Fixture *fixture, int (*body)());
+int __CTF_PARAM_RUN(const char *test_name, int (*case_func)(size_t), size_t count);
+int __CTF_THREADED_RUN(const char *test_name, int (*body)(__CTF_Thread *), int count);
+bool __CTF_THREAD_STOPPED(const __CTF_Thread *thread);
+int __CTF_PROPERTY_RUN(const char *name, int (*body)(const __CTF_Prop_Value *), const __CTF_Generator *gens, int count);
+void __CTF_BENCH_BEGIN(__CTF_Bench *bench);
+bool __CTF_BENCH_END(__CTF_Bench *bench);
+int __CTF_BENCH_RUN(const char *name, int (*body)(__CTF_Bench *));
+int __CTF_BENCH_RANGE_RUN(const char *name, int (*body)(__CTF_Bench *), long long lo, long long hi, long long multiplier);
+void __CTF_SUITE_LINK_IMPL(__CTF_Test_Suite *suite, int (*test_func)(), const char *test_name);
+void __CTF_LIST_TESTS(const __CTF_Test_Suite *suite);
+void __CTF_SUITE_RUN_TESTS(__CTF_Test_Suite suite);
+void __CTF_RUN_SUITE(const char *name, void (*suite_func)());
+void __CTF_REPORTER_ADD(const __CTF_Reporter *reporter);
+void __CTF_RUN_REGISTERED_IMPL(void);
+void __CTF_RUN_SUITES_IMPL(void);
+void __CTF_PROCESS_INIT_IMPL(int argc, char **argv);
+void __CTF_PROCESS_EXIT_IMPL(void);
+#else
+#define __CTF_API static
+#endif
+
+/* What a test module built with CTF_SHARED holds, see ctf-runner */
+typedef struct
+{
+    const __CTF_Suite_Entry *suites;
+    const __CTF_Suite_Entry *suites_end;
+    const __CTF_Test *tests;
+    const __CTF_Test *tests_end;
+} __CTF_Module;
+
+/* Weak, so every translation unit of a module can define it and the linker keeps one */
+#if defined(__CTF_DECLARATIONS_ONLY) && (defined(__GNUC__) || defined(__clang__))
+__attribute__((weak, visibility("default"))) void __ctf_module(__CTF_Module *module)
+{
+    module->suites = __CTF_SUITE_REGISTRY_BEGIN;
+    module->suites_end = __CTF_SUITE_REGISTRY_END;
+    module->tests = __CTF_REGISTRY_BEGIN;
+    module->tests_end = __CTF_REGISTRY_END;
+}
+#endif
+
+#ifndef __CTF_DECLARATIONS_ONLY
+
+__CTF_API char *__CTF_LOG_FILE_NAME = "ctf.log";
+
+__CTF_API __CTF_THREAD_LOCAL char *__ctf_current_test_suite_name = NULL;
+__CTF_API __CTF_THREAD_LOCAL char *__ctf_current_test_name = NULL;
+
+static unsigned int __ctf_suites_ran = 0;
+
+static __CTF_THREAD_LOCAL __CTF_JMP_BUF __ctf_env;
+static __CTF_THREAD_LOCAL volatile sig_atomic_t __signal_caught = 0;
+
+__CTF_API __CTF_THREAD_LOCAL __CTF_Alloc_Stats __ctf_alloc_stats;
+
+/* Case counts of the parametrized test running on this thread, copied into its result like __ctf_alloc_stats */
+static __CTF_THREAD_LOCAL long __ctf_param_cases = 0;
+static __CTF_THREAD_LOCAL long __ctf_param_passed = 0;
+
+/* Nesting depth of framework code a timeout must not jump out of, and whether one came in meanwhile, see Timeouts */
+static __CTF_THREAD_LOCAL volatile sig_atomic_t __ctf_timeout_deferred = 0;
+static __CTF_THREAD_LOCAL volatile sig_atomic_t __ctf_timeout_pending = 0;
+
+static void __CTF_TIMEOUT_FIRE(void);
+
+#define __CTF_TIMEOUT_DEFER() (__ctf_timeout_deferred++)
+#define __CTF_TIMEOUT_RESUME()                                      \
+    do                                                              \
+    {                                                               \
+        if (--__ctf_timeout_deferred == 0 && __ctf_timeout_pending) \
+            __CTF_TIMEOUT_FIRE();                                   \
+    } while (0)
+
+#ifdef __CTF_ALLOC_TRACKING
+/*
+    Only the thread running a test counts, and only while the test function runs, so the framework's own buffers and
+    threads the test starts are left out. A timeout can't jump out of a wrapper while it holds the allocator's lock
+    or has counted only half of a call.
+*/
+static __CTF_THREAD_LOCAL bool __ctf_alloc_active = false;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+static inline void __CTF_ALLOC_ADD(void *ptr)
+{
+    if (!ptr)
+        return;
+    long long size = (long long)malloc_usable_size(ptr);
+    __ctf_alloc_stats.count++;
+    __ctf_alloc_stats.bytes += (unsigned long long)size;
+    __ctf_alloc_stats.live += size;
+    if (__ctf_alloc_stats.live > __ctf_alloc_stats.peak)
+        __ctf_alloc_stats.peak = __ctf_alloc_stats.live;
+}
+
+static inline void __CTF_ALLOC_REMOVE(void *ptr)
+{
+    if (ptr)
+        __ctf_alloc_stats.live -= (long long)malloc_usable_size(ptr);
+}
+
+void *malloc(size_t size)
+{
+    __CTF_TIMEOUT_DEFER();
+    void *ptr = __libc_malloc(size);
+    if (__ctf_alloc_active)
+        __CTF_ALLOC_ADD(ptr);
+    __CTF_TIMEOUT_RESUME();
+    return ptr;
+}
+
+void *calloc(size_t count, size_t size)
+{
+    __CTF_TIMEOUT_DEFER();
+    void *ptr = __libc_calloc(count, size);
+    if (__ctf_alloc_active)
+        __CTF_ALLOC_ADD(ptr);
+    __CTF_TIMEOUT_RESUME();
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    __CTF_TIMEOUT_DEFER();
+    void *grown;
+    if (!__ctf_alloc_active)
+    {
+        grown = __libc_realloc(ptr, size);
+    }
+    else
+    {
+        /* Counted as a free and a new allocation, growing in place still costs a call into the allocator */
+        __CTF_ALLOC_REMOVE(ptr);
+        grown = __libc_realloc(ptr, size);
+        if (grown)
+            __CTF_ALLOC_ADD(grown);
+        else if (ptr && size)
+            __ctf_alloc_stats.live += (long long)malloc_usable_size(ptr);
+    }
+    __CTF_TIMEOUT_RESUME();
+    return grown;
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0)
+        return 22; /* EINVAL */
+    __CTF_TIMEOUT_DEFER();
+    void *ptr = __libc_memalign(alignment, size);
+    if (ptr && __ctf_alloc_active)
+        __CTF_ALLOC_ADD(ptr);
+    __CTF_TIMEOUT_RESUME();
+    if (!ptr)
+        return 12; /* ENOMEM */
+    *out = ptr;
+    return 0;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    __CTF_TIMEOUT_DEFER();
+    void *ptr = __libc_memalign(alignment, size);
+    if (__ctf_alloc_active)
+        __CTF_ALLOC_ADD(ptr);
+    __CTF_TIMEOUT_RESUME();
+    return ptr;
+}
+
+void free(void *ptr)
+{
+    __CTF_TIMEOUT_DEFER();
+    if (__ctf_alloc_active)
+        __CTF_ALLOC_REMOVE(ptr);
+    __libc_free(ptr);
+    __CTF_TIMEOUT_RESUME();
+}
+
+#define __CTF_ALLOC_BEGIN()                                         \
+    do                                                              \
+    {                                                               \
+        memset(&__ctf_alloc_stats, 0, sizeof(__ctf_alloc_stats));   \
+        __ctf_alloc_active = true;                                  \
+    } while (0)
+#define __CTF_ALLOC_END() (__ctf_alloc_active = false)
+#else
+#define __CTF_ALLOC_BEGIN() ((void)0)
+#define __CTF_ALLOC_END() ((void)0)
+#endif
+
+static FILE *__ctf_log_file = NULL;
+
+static double __ctf_process_start_time = -1;
+
+/**
+ * @brief Number of worker threads used to run the tests of a suite. 1 runs them in order on the calling thread.
+ *
+ * @note Set with -j/--jobs, 0 means one worker per online core.
+ */
+static int __ctf_jobs = 1;
+
+/* Set with --list, suites link their tests and print them instead of running them */
+__CTF_API bool __ctf_list_only = false;
+
+/* Set with --watch, ctf-runner reruns modules as they are rebuilt */
+static bool __ctf_watch = false;
+
+/**
+ * @brief Set to true to ask the user if they want to continue testing after a signal is caught or quit. If false we will return to testing. If true we will defer to the user.
+ *
+ * @note When enabled, if you are running the test program from a debugger it may cause the program to hang.
+ */
+static bool __ctf_handle_signal_ask_user = false;
+
+static bool __ctf_try_use_colors = true;
+
+static bool __ctf_use_signal_handlers = true;
+
+/* Wall clock seconds from a monotonic source, clock() is process cpu time and is meaningless across workers */
+__CTF_API double __CTF_NOW(void)
+{
+#if defined(__CTF_POSIX) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* Same source in integer nanoseconds, for deadlines and benchmarks */
+__CTF_API unsigned long long __CTF_NOW_NS(void)
+{
+#if defined(__CTF_POSIX) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+#else
+    return (unsigned long long)((double)clock() / CLOCKS_PER_SEC * 1e9);
+#endif
+}
+
+/* Meant to be crossplatform */
+static bool __CTF_ANSI_COLOR_SUPPORT()
+{
+    if (!__ctf_try_use_colors)
+    {
+        return false;
+    }
+    static bool ran_before = false, supports_colors = false;
+    if (ran_before)
+    {
+        return supports_colors;
+    }
+    ran_before = true;
+    char *term = getenv("TERM");
+    if (term != NULL &&
+        (strstr(term, "xterm") != NULL || strstr(term, "color") != NULL ||
+         strstr(term, "ansi") != NULL || strstr(term, "cygwin") != NULL ||
+         strstr(term, "linux") != NULL || strstr(term, "screen") != NULL ||
+         strstr(term, "tmux") != NULL || strstr(term, "vt100") != NULL ||
+         strstr(term, "rxvt") != NULL || strstr(term, "konsole") != NULL ||
+         strstr(term, "gnome") != NULL || strstr(term, "eterm") != NULL ||
+         strstr(term, "vscode") != NULL))
+    {
+        supports_colors = true;
+        return true;
+    }
+    char *colorterm = getenv("COLORTERM");
+    if (colorterm != NULL &&
+        (strstr(colorterm, "truecolor") != NULL || strstr(colorterm, "24bit") != NULL))
+    {
+        supports_colors = true;
+        return true;
+    }
+    supports_colors = false;
+    return false;
+}
+
+__CTF_API const char *__CTF_ANSI_COLOR(const char *color)
+{
+    if (!__ctf_try_use_colors)
+        return "";
+    static signed char supported = -1;
+    if (supported == -1)
+        supported = __CTF_ANSI_COLOR_SUPPORT();
+    return supported ? color : "";
+}
+
+static bool __CTF_ASK_USER()
+{
+    fflush(stdin);
+    char c = 0;
+    while (c != 'y' && c != 'n' && c != 'Y' && c != 'N' && c != EOF)
+    {
+        printf("[Y/y|N/n]: ");
+        c = getchar();
+        fflush(stdin);
+    }
+    if (c == EOF || c == 'n' || c == 'N')
+    {
+        return false;
+    }
+    return true;
+}
+
+/*
+    Logging pipeline.
+
+    Every message is formatted exactly once, with colors, into a per-thread buffer and then copied into a slot of a
+    bounded lock-free ring (multi producer, single consumer). A background writer drains the ring in batches with
+    plain write(2) calls: the console gets the text as is and the log file gets it with ANSI sequences stripped.
+    Messages that don't fit a slot are written synchronously after draining what is already queued, so order holds.
+    __CTF_LOG_FLUSH drains on the calling thread and only uses atomics and write(2), so it is usable from the
+    signal handler and at exit.
+*/
+
+#define __CTF_LOG_TO_CONSOLE 1
+#define __CTF_LOG_TO_FILE 2
+#define __CTF_LOG_BUFFER_SIZE 4096
+#define __CTF_LOG_SLOT_SIZE 496
+#define __CTF_LOG_RING_SLOTS 1024 /* Must be a power of two */
+#define __CTF_LOG_BATCH_SIZE 16384
+
+static __CTF_THREAD_LOCAL char __ctf_log_buffer[__CTF_LOG_BUFFER_SIZE];
+
+#ifdef __CTF_POSIX
+typedef struct
+{
+    /* Stored relative to the slot index so the zero initialized ring starts out empty */
+    _Atomic size_t sequence;
+    unsigned short length;
+    unsigned char targets;
+    char text[__CTF_LOG_SLOT_SIZE];
+} __CTF_Log_Slot;
+
+static __CTF_Log_Slot __ctf_log_ring[__CTF_LOG_RING_SLOTS];
+static _Atomic size_t __ctf_log_head = 0;
+static _Atomic size_t __ctf_log_tail = 0;
+/* Held by whoever is draining the ring, the writer thread or a flushing thread */
+static atomic_flag __ctf_log_draining = ATOMIC_FLAG_INIT;
+static atomic_bool __ctf_log_stop = false;
+static bool __ctf_log_writer_started = false;
+static pthread_t __ctf_log_writer;
+static pthread_once_t __ctf_log_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t __ctf_log_wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t __ctf_log_wake = PTHREAD_COND_INITIALIZER;
+static int __ctf_log_fd = -1;
+#endif
+
+/* Cleared when a machine readable report is written to stdout */
+static bool __ctf_log_console = true;
+/* Set while a property is being shrunk, the failing attempts would otherwise flood the log */
+static __CTF_THREAD_LOCAL bool __ctf_log_muted = false;
+static const char *__ctf_log_lazy_name = NULL;
+
+#ifdef __CTF_POSIX
+static void __CTF_LOG_SINK_WRITE(int fd, const char *text, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = write(fd, text, length);
+        if (written <= 0)
+            return;
+        text += written;
+        length -= (size_t)written;
+    }
+}
+#endif
+
+/* Copies text into a batch buffer, dropping ANSI escape sequences when the destination is the log file */
+static size_t __CTF_LOG_STRIP_ANSI(char *dest, const char *text, size_t length)
+{
+    size_t i, n = 0;
+    for (i = 0; i < length; i++)
+    {
+        if (text[i] == '\x1b' && i + 1 < length && text[i + 1] == '[')
+        {
+            i += 2;
+            while (i < length && !((text[i] >= 'A' && text[i] <= 'Z') || (text[i] >= 'a' && text[i] <= 'z')))
+                i++;
+            continue;
+        }
+        dest[n++] = text[i];
+    }
+    return n;
+}
+
+#ifdef __CTF_POSIX
+static int __CTF_LOG_FILE_FD(void)
+{
+    if (__ctf_log_file)
+        return fileno(__ctf_log_file);
+    /* Not initialized through __CTF_PROCESS_INIT, open once and keep it for the rest of the process */
+    if (__ctf_log_fd < 0 && __ctf_log_lazy_name)
+        __ctf_log_fd = open(__ctf_log_lazy_name, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    return __ctf_log_fd;
+}
+
+/* Must hold __ctf_log_draining */
+static void __CTF_LOG_DRAIN(void)
+{
+    static char console[__CTF_LOG_BATCH_SIZE], file[__CTF_LOG_BATCH_SIZE];
+    size_t console_length = 0, file_length = 0;
+    int file_fd = __CTF_LOG_FILE_FD();
+    size_t tail = atomic_load_explicit(&__ctf_log_tail, memory_order_relaxed);
+    for (;;)
+    {
+        size_t index = tail & (__CTF_LOG_RING_SLOTS - 1);
+        __CTF_Log_Slot *slot = &__ctf_log_ring[index];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (sequence != tail + 1 - index)
+            break;
+        if (console_length + slot->length > sizeof console)
+        {
+            __CTF_LOG_SINK_WRITE(1, console, console_length);
+            console_length = 0;
+        }
+        if (file_length + slot->length > sizeof file)
+        {
+            if (file_fd >= 0)
+                __CTF_LOG_SINK_WRITE(file_fd, file, file_length);
+            file_length = 0;
+        }
+        if (slot->targets & __CTF_LOG_TO_CONSOLE)
+        {
+            memcpy(console + console_length, slot->text, slot->length);
+            console_length += slot->length;
+        }
+        if (slot->targets & __CTF_LOG_TO_FILE)
+            file_length += __CTF_LOG_STRIP_ANSI(file + file_length, slot->text, slot->length);
+        atomic_store_explicit(&slot->sequence, tail + __CTF_LOG_RING_SLOTS - index, memory_order_release);
+        tail++;
+    }
+    atomic_store_explicit(&__ctf_log_tail, tail, memory_order_relaxed);
+    __CTF_LOG_SINK_WRITE(1, console, console_length);
+    if (file_fd >= 0)
+        __CTF_LOG_SINK_WRITE(file_fd, file, file_length);
+}
+
+static bool __CTF_LOG_TRY_DRAIN(void)
+{
+    if (atomic_flag_test_and_set_explicit(&__ctf_log_draining, memory_order_acquire))
+        return false;
+    __CTF_LOG_DRAIN();
+    atomic_flag_clear_explicit(&__ctf_log_draining, memory_order_release);
+    return true;
+}
+
+static void *__CTF_LOG_WRITER_MAIN(void *arg)
+{
+    (void)arg;
+    while (!atomic_load(&__ctf_log_stop))
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 10 * 1000000;
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        pthread_mutex_lock(&__ctf_log_wake_lock);
+        pthread_cond_timedwait(&__ctf_log_wake, &__ctf_log_wake_lock, &deadline);
+        pthread_mutex_unlock(&__ctf_log_wake_lock);
+        /* Keep whatever the tests printf'd themselves roughly in order with our output */
+        fflush(stdout);
+        __CTF_LOG_TRY_DRAIN();
+    }
+    return NULL;
+}
+
+static void __CTF_LOG_ATEXIT(void);
+
+static void __CTF_LOG_START(void)
+{
+    __ctf_log_writer_started = pthread_create(&__ctf_log_writer, NULL, __CTF_LOG_WRITER_MAIN, NULL) == 0;
+    atexit(__CTF_LOG_ATEXIT);
+}
+#endif
+
+/**
+ * @brief Writes out everything queued so far on the calling thread.
+ *
+ * @note Only uses atomics and write(2) so it is safe to call from __CTF_HANDLE_SIGNAL.
+ */
+static void __CTF_LOG_FLUSH(void)
+{
+#ifdef __CTF_POSIX
+    /* The writer only holds the flag for one batch, don't wait forever if its owner died */
+    long spins = 100000000;
+    __CTF_TIMEOUT_DEFER();
+    while (atomic_flag_test_and_set_explicit(&__ctf_log_draining, memory_order_acquire))
+    {
+        if (--spins == 0)
+        {
+            __CTF_TIMEOUT_RESUME();
+            return;
+        }
+    }
+    __CTF_LOG_DRAIN();
+    atomic_flag_clear_explicit(&__ctf_log_draining, memory_order_release);
+    __CTF_TIMEOUT_RESUME();
+#else
+    fflush(stdout);
+    if (__ctf_log_file)
+        fflush(__ctf_log_file);
+#endif
+}
+
+/* Stops the writer thread and flushes, used when the process exits */
+static void __CTF_LOG_SHUTDOWN(void)
+{
+#ifdef __CTF_POSIX
+    if (__ctf_log_writer_started && !atomic_exchange(&__ctf_log_stop, true))
+    {
+        pthread_cond_signal(&__ctf_log_wake);
+        pthread_join(__ctf_log_writer, NULL);
+        /* Anything logged from here on is drained by the thread logging it */
+        __ctf_log_writer_started = false;
+    }
+    fflush(stdout);
+#endif
+    __CTF_LOG_FLUSH();
+}
+
+#ifdef __CTF_POSIX
+static void __CTF_LOG_ATEXIT(void)
+{
+    __CTF_LOG_SHUTDOWN();
+}
+#endif
+
+/* Hands one formatted message to the pipeline */
+static void __CTF_LOG_SUBMIT(const char *text, size_t length, int targets)
+{
+    if (!__ctf_log_console)
+        targets &= ~__CTF_LOG_TO_CONSOLE;
+    if (!targets)
+        return;
+#ifdef __CTF_POSIX
+    /* A slot reserved but never published, or the drain flag left held, would stall the log for good */
+    __CTF_TIMEOUT_DEFER();
+    pthread_once(&__ctf_log_once, __CTF_LOG_START);
+    if (length > __CTF_LOG_SLOT_SIZE)
+    {
+        while (atomic_flag_test_and_set_explicit(&__ctf_log_draining, memory_order_acquire))
+            ;
+        __CTF_LOG_DRAIN();
+        int file_fd = __CTF_LOG_FILE_FD();
+        if (targets & __CTF_LOG_TO_CONSOLE)
+            __CTF_LOG_SINK_WRITE(1, text, length);
+        if ((targets & __CTF_LOG_TO_FILE) && file_fd >= 0)
+        {
+            char stripped[__CTF_LOG_BUFFER_SIZE];
+            __CTF_LOG_SINK_WRITE(file_fd, stripped, __CTF_LOG_STRIP_ANSI(stripped, text, length));
+        }
+        atomic_flag_clear_explicit(&__ctf_log_draining, memory_order_release);
+        __CTF_TIMEOUT_RESUME();
+        return;
+    }
+    size_t head = atomic_load_explicit(&__ctf_log_head, memory_order_relaxed);
+    __CTF_Log_Slot *slot;
+    for (;;)
+    {
+        size_t index = head & (__CTF_LOG_RING_SLOTS - 1);
+        slot = &__ctf_log_ring[index];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (sequence == head - index)
+        {
+            if (atomic_compare_exchange_weak_explicit(&__ctf_log_head, &head, head + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (sequence < head - index)
+        {
+            /* Full, help the writer out rather than dropping the message */
+            if (!__ctf_log_writer_started || !__CTF_LOG_TRY_DRAIN())
+                sched_yield();
+            head = atomic_load_explicit(&__ctf_log_head, memory_order_relaxed);
+        }
+        else
+        {
+            head = atomic_load_explicit(&__ctf_log_head, memory_order_relaxed);
+        }
+    }
+    memcpy(slot->text, text, length);
+    slot->length = (unsigned short)length;
+    slot->targets = (unsigned char)targets;
+    atomic_store_explicit(&slot->sequence, head + 1 - (head & (__CTF_LOG_RING_SLOTS - 1)), memory_order_release);
+    if (!__ctf_log_writer_started)
+        __CTF_LOG_TRY_DRAIN();
+    else if (head - atomic_load_explicit(&__ctf_log_tail, memory_order_relaxed) == __CTF_LOG_RING_SLOTS / 2)
+        pthread_cond_signal(&__ctf_log_wake);
+    __CTF_TIMEOUT_RESUME();
+#else
+    if (targets & __CTF_LOG_TO_CONSOLE)
+        fwrite(text, 1, length, stdout);
+    if ((targets & __CTF_LOG_TO_FILE) && __ctf_log_file)
+    {
+        char stripped[__CTF_LOG_BUFFER_SIZE];
+        fwrite(stripped, 1, __CTF_LOG_STRIP_ANSI(stripped, text, length), __ctf_log_file);
+    }
+#endif
+}
+
+static size_t __CTF_LOG_FORMAT(char *buffer, size_t offset, const char *format, va_list args)
+{
+    if (offset >= __CTF_LOG_BUFFER_SIZE)
+        return offset;
+    int written = vsnprintf(buffer + offset, __CTF_LOG_BUFFER_SIZE - offset, format, args);
+    if (written < 0)
+        return offset;
+    offset += (size_t)written;
+    return offset < __CTF_LOG_BUFFER_SIZE ? offset : __CTF_LOG_BUFFER_SIZE - 1;
+}
+
+static size_t __CTF_LOG_FORMAT_ARGS(char *buffer, size_t offset, const char *format, ...) __CTF_PRINTF_FORMAT(3, 4);
+static size_t __CTF_LOG_FORMAT_ARGS(char *buffer, size_t offset, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    offset = __CTF_LOG_FORMAT(buffer, offset, format, args);
+    va_end(args);
+    return offset;
+}
+
+#define __CTF_LOG_ARGS_COLOR(suite, test) "%s[LOG%s%s%s%s]%s ", __CTF_ANSI_YELLOW, suite ? "/" : "", suite ? __ctf_current_test_suite_name : "", test ? "/" : "", test ? __ctf_current_test_name : "", __CTF_ANSI_RESET
+
+/**
+ * @brief Formats a log line once and queues it for both the console and the log file.
+ *
+ * @note Takes a filename rather than FILE* because the log must be written even if __CTF_PROCESS_INIT was never called.
+ */
+__CTF_API void __CTF_LOG_WRITE(const char *filename, const char *format, ...) __CTF_PRINTF_FORMAT(2, 3);
+__CTF_API void __CTF_LOG_WRITE(const char *filename, const char *format, ...)
+{
+    /* Nothing runs with --list, keep its output to the listing itself */
+    if (__ctf_list_only || __ctf_log_muted)
+        return;
+    bool suite = __ctf_current_test_suite_name != NULL;
+    bool test = __ctf_current_test_name != NULL;
+    if (!__ctf_log_file && !__ctf_log_lazy_name)
+        __ctf_log_lazy_name = filename;
+    /* vsnprintf may allocate */
+    __CTF_TIMEOUT_DEFER();
+    size_t length = __CTF_LOG_FORMAT_ARGS(__ctf_log_buffer, 0, __CTF_LOG_ARGS_COLOR(suite, test));
+    va_list args;
+    va_start(args, format);
+    length = __CTF_LOG_FORMAT(__ctf_log_buffer, length, format, args);
+    va_end(args);
+    __ctf_log_buffer[length++] = '\n';
+    __CTF_LOG_SUBMIT(__ctf_log_buffer, length, __CTF_LOG_TO_CONSOLE | __CTF_LOG_TO_FILE);
+    __CTF_TIMEOUT_RESUME();
+}
+
+/**
+ * @brief printf for framework output that only goes to the console, queued through the same pipeline as __CTF_LOG so the two stay in order.
+ *
+ */
+static void __CTF_PRINT(const char *format, ...) __CTF_PRINTF_FORMAT(1, 2);
+static void __CTF_PRINT(const char *format, ...)
+{
+    va_list args;
+    __CTF_TIMEOUT_DEFER();
+    va_start(args, format);
+    size_t length = __CTF_LOG_FORMAT(__ctf_log_buffer, 0, format, args);
+    va_end(args);
+    __CTF_LOG_SUBMIT(__ctf_log_buffer, length, __CTF_LOG_TO_CONSOLE);
+    __CTF_TIMEOUT_RESUME();
+}
+
+/* Prints a line of count copies of c, used for the suite banners */
+__CTF_API void __CTF_PRINT_RULE(char c, int count)
+{
+    char line[__CTF_LOG_SLOT_SIZE];
+    if (count > (int)sizeof line - 1)
+        count = (int)sizeof line - 1;
+    if (count < 0)
+        count = 0;
+    memset(line, c, count);
+    line[count] = '\n';
+    __CTF_LOG_SUBMIT(line, count + 1, __CTF_LOG_TO_CONSOLE);
+}
+
+static void __CTF_REPORT_PROCESS_EXIT(unsigned int suites_ran, double elapsed);
+static int __CTF_BASELINE_FINISH(void);
+static void __CTF_CACHE_FINISH(void);
+static void __CTF_TRACE_FINISH(void);
+static void __CTF_REPEAT_FINISH(void);
+
+__CTF_API void __CTF_PROCESS_EXIT_IMPL(void)
+{
+    __CTF_REPEAT_FINISH();
+    __CTF_LOG("Testing complete. %d suite(s) ran.", __ctf_suites_ran);
+    float runtime = __CTF_NOW() - __ctf_process_start_time;
+    __CTF_REPORT_PROCESS_EXIT(__ctf_suites_ran, __ctf_process_start_time != -1 ? runtime : 0);
+    int status = __CTF_BASELINE_FINISH();
+    __CTF_CACHE_FINISH();
+    __CTF_TRACE_FINISH();
+    __CTF_LOG("Testing process completed in %fs.", __ctf_process_start_time != -1 ? runtime : -1.0f);
+    __CTF_LOG_SHUTDOWN();
+    if (__ctf_log_file)
+    {
         fclose(__ctf_log_file);
         __ctf_log_file = NULL;
     }
-    exit(0);
+    exit(status);
+}
+
+/*
+    Crash capture.
+
+    The handler runs on a per thread alternate stack, so a stack overflow is caught like any other crash. It only
+    fills the thread's preallocated crash record, with the signal, the faulting address, the registers and a raw
+    backtrace, and jumps back into the runner. The runner then logs the record and symbolizes the backtrace outside
+    the handler, where stdio and malloc are safe. A crash outside of a test can't be recovered from, so the record
+    is written to stderr with write(2) only and the signal is raised again with the default action.
+*/
+
+#define __CTF_CRASH_FRAMES 64
+#define __CTF_CRASH_MAX_REGISTERS 34
+#define __CTF_ALT_STACK_SIZE (64 * 1024)
+
+#if defined(__linux__) && defined(__x86_64__)
+/* In the order of the kernel's sigcontext, which is how glibc and musl lay out gregs */
+static const char *const __ctf_crash_register_names[] = {"r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15", "rdi",
+                                                         "rsi", "rbp", "rbx", "rdx", "rax", "rcx", "rsp", "rip", "eflags"};
+#define __CTF_CRASH_REGISTERS 18
+#define __CTF_CRASH_IP_REGISTER 16
+#elif defined(__linux__) && defined(__aarch64__)
+static const char *const __ctf_crash_register_names[] = {"x0", "x1", "x2", "x3", "x4", "x5", "x6", "x7", "x8", "x9",
+                                                         "x10", "x11", "x12", "x13", "x14", "x15", "x16", "x17", "x18",
+                                                         "x19", "x20", "x21", "x22", "x23", "x24", "x25", "x26", "x27",
+                                                         "x28", "x29", "x30", "sp", "pc"};
+#define __CTF_CRASH_REGISTERS 33
+#define __CTF_CRASH_IP_REGISTER 32
+#else
+static const char *const __ctf_crash_register_names[] = {""};
+#define __CTF_CRASH_REGISTERS 0
+#define __CTF_CRASH_IP_REGISTER -1
+#endif
+
+typedef struct
+{
+    int signal;
+    int code;
+    void *address;
+    int register_count;
+    unsigned long long registers[__CTF_CRASH_MAX_REGISTERS];
+    int frame_count;
+    void *frames[__CTF_CRASH_FRAMES];
+} __CTF_Crash_Record;
+
+static __CTF_THREAD_LOCAL __CTF_Crash_Record __ctf_crash;
+/* Set while __ctf_env belongs to a test running on this thread, the handler only jumps when it is */
+static __CTF_THREAD_LOCAL volatile sig_atomic_t __ctf_crash_recoverable = 0;
+#ifdef __CTF_POSIX
+static __CTF_THREAD_LOCAL void *__ctf_alt_stack = NULL;
+#endif
+#ifdef __CTF_HAS_BACKTRACE
+static pthread_once_t __ctf_backtrace_once = PTHREAD_ONCE_INIT;
+
+/* The first backtrace call may load the unwinder, which must not happen inside the handler */
+static void __CTF_BACKTRACE_WARM(void)
+{
+    void *frame;
+    backtrace(&frame, 1);
+}
+#endif
+
+static const char *__CTF_SIGNAL_NAME(int sig)
+{
+    switch (sig)
+    {
+    case SIGSEGV:
+        return "Segmentation fault";
+    case SIGFPE:
+        return "Floating point exception";
+    case SIGILL:
+        return "Illegal instruction";
+    case SIGABRT:
+        return "Aborted";
+#ifdef SIGBUS
+    case SIGBUS:
+        return "Bus error";
+#endif
+    default:
+        return "Unknown signal";
+    }
+}
+
+#ifdef __CTF_POSIX
+static void __CTF_HANDLE_SIGNAL(int sig, siginfo_t *info, void *context);
+#else
+static void __CTF_HANDLE_SIGNAL(int sig);
+#endif
+
+/* Register signal handlers macro */
+static void __CTF_REGISTER_SIGNAL_HANDLERS(void)
+{
+#ifdef __CTF_POSIX
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = __CTF_HANDLE_SIGNAL;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, NULL);
+    sigaction(SIGFPE, &action, NULL);
+    sigaction(SIGILL, &action, NULL);
+    sigaction(SIGABRT, &action, NULL);
+    sigaction(SIGBUS, &action, NULL);
+#ifdef __CTF_HAS_BACKTRACE
+    pthread_once(&__ctf_backtrace_once, __CTF_BACKTRACE_WARM);
+#endif
+#else
+    signal(SIGSEGV, __CTF_HANDLE_SIGNAL);
+    signal(SIGFPE, __CTF_HANDLE_SIGNAL);
+    signal(SIGILL, __CTF_HANDLE_SIGNAL);
+    signal(SIGABRT, __CTF_HANDLE_SIGNAL);
+#endif
+}
+
+/* Reset signal handlers macro */
+static void __CTF_RESET_SIGNAL_HANDLERS(void)
+{
+    signal(SIGSEGV, SIG_DFL);
+    signal(SIGFPE, SIG_DFL);
+    signal(SIGILL, SIG_DFL);
+    signal(SIGABRT, SIG_DFL);
+#ifdef SIGBUS
+    signal(SIGBUS, SIG_DFL);
+#endif
+}
+
+/**
+ * @brief Gives the calling thread an alternate signal stack the first time it runs a test, unless it already has one.
+ *
+ */
+static void __CTF_CRASH_STACK(void)
+{
+#ifdef __CTF_POSIX
+    if (__ctf_alt_stack || !__ctf_use_signal_handlers)
+        return;
+    stack_t stack;
+    if (sigaltstack(NULL, &stack) == 0 && !(stack.ss_flags & SS_DISABLE))
+        return;
+    __ctf_alt_stack = malloc(__CTF_ALT_STACK_SIZE);
+    if (!__ctf_alt_stack)
+        return;
+    stack.ss_sp = __ctf_alt_stack;
+    stack.ss_size = __CTF_ALT_STACK_SIZE;
+    stack.ss_flags = 0;
+    if (sigaltstack(&stack, NULL) != 0)
+    {
+        free(__ctf_alt_stack);
+        __ctf_alt_stack = NULL;
+    }
+#endif
+}
+
+/* Removes the alternate stack of a worker thread before it exits */
+static __CTF_MAYBE_UNUSED void __CTF_CRASH_RELEASE(void)
+{
+#ifdef __CTF_POSIX
+    if (!__ctf_alt_stack)
+        return;
+    stack_t stack;
+    memset(&stack, 0, sizeof(stack));
+    stack.ss_flags = SS_DISABLE;
+    sigaltstack(&stack, NULL);
+    free(__ctf_alt_stack);
+    __ctf_alt_stack = NULL;
+#endif
+}
+
+/* Appends text to buffer without stdio, safe inside the handler */
+static size_t __CTF_CRASH_TEXT(char *buffer, size_t offset, size_t size, const char *text)
+{
+    while (*text && offset + 1 < size)
+        buffer[offset++] = *text++;
+    return offset;
+}
+
+static size_t __CTF_CRASH_NUMBER(char *buffer, size_t offset, size_t size, unsigned long long value, unsigned int base)
+{
+    char digits[24];
+    int count = 0;
+    if (base == 16)
+        offset = __CTF_CRASH_TEXT(buffer, offset, size, "0x");
+    do
+    {
+        digits[count++] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value);
+    while (count > 0 && offset + 1 < size)
+        buffer[offset++] = digits[--count];
+    return offset;
+}
+
+/* Fills the crash record of the calling thread, only async-signal-safe calls from here on */
+static void __CTF_CRASH_CAPTURE(int sig, void *info, void *context)
+{
+    __ctf_crash.signal = sig;
+    __ctf_crash.code = 0;
+    __ctf_crash.address = NULL;
+    __ctf_crash.register_count = 0;
+    __ctf_crash.frame_count = 0;
+#ifdef __CTF_POSIX
+    if (info)
+    {
+        __ctf_crash.code = ((siginfo_t *)info)->si_code;
+        __ctf_crash.address = ((siginfo_t *)info)->si_addr;
+    }
+#else
+    (void)info;
+#endif
+#if defined(__CTF_POSIX) && defined(__linux__) && defined(__x86_64__)
+    if (context)
+    {
+        int i;
+        for (i = 0; i < __CTF_CRASH_REGISTERS; i++)
+            __ctf_crash.registers[i] = (unsigned long long)((ucontext_t *)context)->uc_mcontext.gregs[i];
+        __ctf_crash.register_count = __CTF_CRASH_REGISTERS;
+    }
+#elif defined(__CTF_POSIX) && defined(__linux__) && defined(__aarch64__)
+    if (context)
+    {
+        const mcontext_t *machine = &((ucontext_t *)context)->uc_mcontext;
+        int i;
+        for (i = 0; i < 31; i++)
+            __ctf_crash.registers[i] = (unsigned long long)machine->regs[i];
+        __ctf_crash.registers[31] = (unsigned long long)machine->sp;
+        __ctf_crash.registers[32] = (unsigned long long)machine->pc;
+        __ctf_crash.register_count = __CTF_CRASH_REGISTERS;
+    }
+#else
+    (void)context;
+#endif
+#ifdef __CTF_HAS_BACKTRACE
+    __ctf_crash.frame_count = backtrace(__ctf_crash.frames, __CTF_CRASH_FRAMES);
+#endif
+}
+
+/* Index of the faulting frame, so the handler's own frames are left out of the backtrace */
+static __CTF_MAYBE_UNUSED int __CTF_CRASH_FIRST_FRAME(void)
+{
+    int i;
+    if (__CTF_CRASH_IP_REGISTER < 0 || __ctf_crash.register_count <= __CTF_CRASH_IP_REGISTER)
+        return 0;
+    for (i = 0; i < __ctf_crash.frame_count; i++)
+    {
+        if ((unsigned long long)__ctf_crash.frames[i] == __ctf_crash.registers[__CTF_CRASH_IP_REGISTER])
+            return i;
+    }
+    return 0;
+}
+
+/* Writes the record to stderr when there is no test to recover into */
+static void __CTF_CRASH_WRITE(void)
+{
+    char buffer[512];
+    size_t length = __CTF_CRASH_TEXT(buffer, 0, sizeof(buffer), "CTF: caught signal ");
+    length = __CTF_CRASH_NUMBER(buffer, length, sizeof(buffer), (unsigned long long)__ctf_crash.signal, 10);
+    length = __CTF_CRASH_TEXT(buffer, length, sizeof(buffer), " (");
+    length = __CTF_CRASH_TEXT(buffer, length, sizeof(buffer), __CTF_SIGNAL_NAME(__ctf_crash.signal));
+    length = __CTF_CRASH_TEXT(buffer, length, sizeof(buffer), ") at address ");
+    length = __CTF_CRASH_NUMBER(buffer, length, sizeof(buffer), (unsigned long long)(size_t)__ctf_crash.address, 16);
+    length = __CTF_CRASH_TEXT(buffer, length, sizeof(buffer), " outside of a test\n");
+    int i;
+    for (i = 0; i < __ctf_crash.register_count; i++)
+    {
+        length = __CTF_CRASH_TEXT(buffer, length, sizeof(buffer), i % 6 == 0 ? "\t" : " ");
+        length = __CTF_CRASH_TEXT(buffer, length, sizeof(buffer), __ctf_crash_register_names[i]);
+        length = __CTF_CRASH_TEXT(buffer, length, sizeof(buffer), " ");
+        length = __CTF_CRASH_NUMBER(buffer, length, sizeof(buffer), __ctf_crash.registers[i], 16);
+        if (i % 6 == 5 || i + 1 == __ctf_crash.register_count)
+            length = __CTF_CRASH_TEXT(buffer, length, sizeof(buffer), "\n");
+    }
+#ifdef __CTF_POSIX
+    if (write(STDERR_FILENO, buffer, length) < 0)
+        return;
+#else
+    fwrite(buffer, 1, length, stderr);
+#endif
+#ifdef __CTF_HAS_BACKTRACE
+    int first = __CTF_CRASH_FIRST_FRAME();
+    backtrace_symbols_fd(__ctf_crash.frames + first, __ctf_crash.frame_count - first, STDERR_FILENO);
+#endif
+}
+
+/* Signal handling functions */
+#ifdef __CTF_POSIX
+static void __CTF_HANDLE_SIGNAL(int sig, siginfo_t *info, void *context)
+#else
+static void __CTF_HANDLE_SIGNAL(int sig)
+#endif
+{
+#ifdef __CTF_POSIX
+    __CTF_CRASH_CAPTURE(sig, info, context);
+#else
+    __CTF_CRASH_CAPTURE(sig, NULL, NULL);
+#endif
+    if (!__ctf_crash_recoverable)
+    {
+        /* Get the lines queued before the crash out first, __CTF_LOG_FLUSH only uses atomics and write(2) */
+        __CTF_LOG_FLUSH();
+        __CTF_CRASH_WRITE();
+        /* Die of the same signal, a fault rethrows when the handler returns and anything else is pending until then */
+        __CTF_RESET_SIGNAL_HANDLERS();
+        raise(sig);
+        return;
+    }
+    /* Other workers may still be running tests and need the handlers */
+    if (__ctf_jobs <= 1)
+        __CTF_RESET_SIGNAL_HANDLERS();
+    __signal_caught = sig;
+    /* Jump back to tests */
+    __CTF_LONGJMP(__ctf_env, 1);
+}
+
+/* Logs the crash record of the calling thread, symbolizing its backtrace now that it is safe to */
+static void __CTF_CRASH_LOG(void)
+{
+    size_t length = 0;
+    char *buffer = (char *)malloc(__CTF_LOG_BUFFER_SIZE);
+    if (!buffer)
+        return;
+    length = __CTF_LOG_FORMAT_ARGS(buffer, length, "\n\tCaught signal: %s (%d)", __CTF_SIGNAL_NAME(__ctf_crash.signal), __ctf_crash.signal);
+    if (__ctf_current_test_name != NULL)
+        length = __CTF_LOG_FORMAT_ARGS(buffer, length, "\n\tError occurred during test: %s", __ctf_current_test_name);
+    if (__ctf_current_test_suite_name != NULL)
+        length = __CTF_LOG_FORMAT_ARGS(buffer, length, "\n\tIn test suite: %s", __ctf_current_test_suite_name);
+    if (__ctf_crash.signal == SIGSEGV || __ctf_crash.signal == SIGFPE || __ctf_crash.signal == SIGILL)
+        length = __CTF_LOG_FORMAT_ARGS(buffer, length, "\n\tFault address: %p", __ctf_crash.address);
+    int i;
+    for (i = 0; i < __ctf_crash.register_count; i++)
+        length = __CTF_LOG_FORMAT_ARGS(buffer, length, "%s%s 0x%llx", i % 6 == 0 ? "\n\t\t" : " ", __ctf_crash_register_names[i], __ctf_crash.registers[i]);
+    __CTF_LOG("%s%s%s", __CTF_ANSI_RED, buffer, __CTF_ANSI_RESET);
+#ifdef __CTF_HAS_BACKTRACE
+    int first = __CTF_CRASH_FIRST_FRAME();
+    char **symbols = __ctf_crash.frame_count > first ? backtrace_symbols(__ctf_crash.frames + first, __ctf_crash.frame_count - first) : NULL;
+    if (symbols)
+    {
+        length = __CTF_LOG_FORMAT_ARGS(buffer, 0, "Backtrace:");
+        for (i = 0; i < __ctf_crash.frame_count - first; i++)
+            length = __CTF_LOG_FORMAT_ARGS(buffer, length, "\n\t#%d %s", i, symbols[i]);
+        __CTF_LOG("%s", buffer);
+        free(symbols);
+    }
+#endif
+    (void)length;
+    free(buffer);
+}
+
+/**
+ * @brief Everything a crash needs once the runner has jumped back: the report, the handlers and --ask-signal.
+ *
+ */
+static void __CTF_CRASH_RECOVER(void)
+{
+    __CTF_CRASH_LOG();
+    /* Get everything up to the crash out before anything else can go wrong */
+    __CTF_LOG_FLUSH();
+    if (__ctf_use_signal_handlers)
+        __CTF_REGISTER_SIGNAL_HANDLERS();
+    if (__ctf_handle_signal_ask_user && !__ctf_log_muted)
+    {
+        printf("Do you want to continue testing? ");
+        if (!__CTF_ASK_USER())
+        {
+            __CTF_LOG("User chose to exit after signal %d.", __ctf_crash.signal);
+            __CTF_PROCESS_EXIT_IMPL();
+        }
+    }
+}
+
+/*
+    Timeouts.
+
+    Every thread running a test owns a watch slot holding its thread id and the test's deadline. A watchdog thread
+    polls the slots and sends CTF_TIMEOUT_SIGNAL to a thread that is past its deadline; the handler jumps back through
+    the same recovery path as a crash and the test is recorded as timed out. A deadline is only armed while the test
+    function itself is running, a signal that arrives after it returned is ignored. Framework code called from a test
+    that holds a lock, a log ring slot or goes through malloc or stdio is wrapped in __CTF_TIMEOUT_DEFER and
+    __CTF_TIMEOUT_RESUME, a timeout arriving inside jumps when the outermost one is left. Calls the test makes into
+    the C library itself can't be protected like this.
+*/
+
+#ifndef CTF_TIMEOUT_SIGNAL
+#define CTF_TIMEOUT_SIGNAL SIGUSR2
+#endif
+
+#define __CTF_WATCH_SLOTS 1024
+#define __CTF_WATCH_IDLE 0ull
+#define __CTF_WATCH_FIRED 1ull
+
+/* Default timeout of every test in milliseconds, 0 for none. Set with --timeout */
+static unsigned long __ctf_timeout_ms = 0;
+
+static __CTF_THREAD_LOCAL volatile sig_atomic_t __ctf_watch_armed = 0;
+static __CTF_THREAD_LOCAL volatile sig_atomic_t __ctf_timed_out = 0;
+static __CTF_THREAD_LOCAL unsigned long long __ctf_test_start_ns = 0;
+
+#ifdef __CTF_POSIX
+typedef struct
+{
+    _Atomic unsigned long long deadline;
+    pthread_t thread;
+    atomic_bool in_use;
+} __CTF_Watch_Slot;
+
+static __CTF_Watch_Slot __ctf_watch_slots[__CTF_WATCH_SLOTS];
+static _Atomic int __ctf_watch_count = 0;
+static pthread_once_t __ctf_watchdog_once = PTHREAD_ONCE_INIT;
+static bool __ctf_watchdog_started = false;
+static __CTF_THREAD_LOCAL int __ctf_watch_slot = -1;
+
+static void __CTF_HANDLE_TIMEOUT(int sig)
+{
+    if (!__ctf_watch_armed)
+        return;
+    if (__ctf_timeout_deferred)
+    {
+        __ctf_timeout_pending = 1;
+        return;
+    }
+    __ctf_timeout_pending = 0;
+    __ctf_watch_armed = 0;
+    __ctf_timed_out = 1;
+    __signal_caught = sig;
+    __CTF_LONGJMP(__ctf_env, 1);
+}
+
+static void *__CTF_WATCHDOG_MAIN(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        unsigned long long now = __CTF_NOW_NS(), next = now + 10000000ull;
+        int i, count = atomic_load(&__ctf_watch_count);
+        for (i = 0; i < count; i++)
+        {
+            __CTF_Watch_Slot *slot = &__ctf_watch_slots[i];
+            unsigned long long deadline = atomic_load_explicit(&slot->deadline, memory_order_acquire);
+            if (deadline <= __CTF_WATCH_FIRED)
+                continue;
+            if (deadline > now)
+            {
+                if (deadline < next)
+                    next = deadline;
+                continue;
+            }
+            pthread_t thread = slot->thread;
+            /* Fails if the test finished or the slot was rearmed since we read it */
+            if (atomic_compare_exchange_strong(&slot->deadline, &deadline, __CTF_WATCH_FIRED))
+                pthread_kill(thread, CTF_TIMEOUT_SIGNAL);
+        }
+        unsigned long long wait = next - now;
+        struct timespec ts = {(time_t)(wait / 1000000000ull), (long)(wait % 1000000000ull)};
+        nanosleep(&ts, NULL);
+    }
+    return NULL;
+}
+
+static void __CTF_WATCHDOG_START(void)
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof action);
+    action.sa_handler = __CTF_HANDLE_TIMEOUT;
+    sigemptyset(&action.sa_mask);
+    sigaction(CTF_TIMEOUT_SIGNAL, &action, NULL);
+    pthread_t watchdog;
+    if (pthread_create(&watchdog, NULL, __CTF_WATCHDOG_MAIN, NULL) == 0)
+    {
+        pthread_detach(watchdog);
+        __ctf_watchdog_started = true;
+    }
+}
+
+static __CTF_Watch_Slot *__CTF_WATCH_SLOT(void)
+{
+    if (__ctf_watch_slot >= 0)
+        return &__ctf_watch_slots[__ctf_watch_slot];
+    int i;
+    for (i = 0; i < __CTF_WATCH_SLOTS; i++)
+    {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&__ctf_watch_slots[i].in_use, &expected, true))
+        {
+            __ctf_watch_slots[i].thread = pthread_self();
+            int count = atomic_load(&__ctf_watch_count);
+            while (count <= i && !atomic_compare_exchange_weak(&__ctf_watch_count, &count, i + 1))
+                ;
+            __ctf_watch_slot = i;
+            return &__ctf_watch_slots[i];
+        }
+    }
+    return NULL;
+}
+#endif
+
+/* Jumps for a timeout that came in while it was deferred */
+static void __CTF_TIMEOUT_FIRE(void)
+{
+#ifdef __CTF_POSIX
+    __CTF_HANDLE_TIMEOUT(CTF_TIMEOUT_SIGNAL);
+#else
+    __ctf_timeout_pending = 0;
+#endif
+}
+
+/**
+ * @brief Gives the test running on this thread a deadline of timeout_ms after it started, 0 removes it.
+ *
+ */
+__CTF_API void __CTF_WATCH_ARM(unsigned long timeout_ms)
+{
+    /* A crash jumping out of deferred framework code leaves the count behind, no test starts inside one */
+    __ctf_timeout_deferred = 0;
+    __ctf_timeout_pending = 0;
+#ifdef __CTF_POSIX
+    if (timeout_ms == 0)
+    {
+        if (__ctf_watch_slot >= 0)
+            atomic_store(&__ctf_watch_slots[__ctf_watch_slot].deadline, __CTF_WATCH_IDLE);
+        return;
+    }
+    pthread_once(&__ctf_watchdog_once, __CTF_WATCHDOG_START);
+    __CTF_Watch_Slot *slot = __ctf_watchdog_started ? __CTF_WATCH_SLOT() : NULL;
+    if (!slot)
+    {
+        __CTF_LOG("%sTimeouts are unavailable, running without one.%s", __CTF_ANSI_RED, __CTF_ANSI_RESET);
+        return;
+    }
+    __ctf_watch_armed = 1;
+    atomic_store_explicit(&slot->deadline, __ctf_test_start_ns + (unsigned long long)timeout_ms * 1000000ull, memory_order_release);
+#else
+    (void)timeout_ms;
+#endif
+}
+
+static void __CTF_WATCH_DISARM(void)
+{
+    __ctf_watch_armed = 0;
+    __ctf_timeout_pending = 0;
+#ifdef __CTF_POSIX
+    if (__ctf_watch_slot >= 0)
+        atomic_store(&__ctf_watch_slots[__ctf_watch_slot].deadline, __CTF_WATCH_IDLE);
+#endif
+}
+
+/* Gives the slot back when a worker thread exits */
+static __CTF_MAYBE_UNUSED void __CTF_WATCH_RELEASE(void)
+{
+#ifdef __CTF_POSIX
+    if (__ctf_watch_slot >= 0)
+    {
+        atomic_store(&__ctf_watch_slots[__ctf_watch_slot].deadline, __CTF_WATCH_IDLE);
+        atomic_store(&__ctf_watch_slots[__ctf_watch_slot].in_use, false);
+        __ctf_watch_slot = -1;
+    }
+#endif
+}
+
+/*
+    Performance counters (--perf).
+
+    Each thread that runs tests opens its own group of hardware counters (cycles, instructions, cache and branch
+    misses) for itself, counting user space only so the default perf_event_paranoid setting allows it. The group is
+    reset and enabled right before the test function and disabled right after. Where perf_event_open is missing or
+    blocked, as in most containers, only the getrusage numbers (page faults, context switches, peak RSS) are recorded
+    and the hardware fields are reported as unavailable.
+*/
+
+/* Set with --perf */
+static bool __ctf_perf = false;
+
+#define __CTF_PERF_HW_EVENTS 4
+
+#ifdef __CTF_HAS_PERF_EVENT
+/* -2 not tried yet, -1 unavailable on this thread */
+static __CTF_THREAD_LOCAL int __ctf_perf_fds[__CTF_PERF_HW_EVENTS] = {-2, -2, -2, -2};
+
+static int __CTF_PERF_OPEN_EVENT(unsigned long long config, int group)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = group == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, PERF_FLAG_FD_CLOEXEC);
+}
+
+static bool __CTF_PERF_OPEN(void)
+{
+    static const unsigned long long configs[__CTF_PERF_HW_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+    int i;
+    if (__ctf_perf_fds[0] != -2)
+        return __ctf_perf_fds[0] >= 0;
+    for (i = 0; i < __CTF_PERF_HW_EVENTS; i++)
+    {
+        __ctf_perf_fds[i] = __CTF_PERF_OPEN_EVENT(configs[i], i == 0 ? -1 : __ctf_perf_fds[0]);
+        if (__ctf_perf_fds[i] < 0)
+        {
+            /* All or nothing, a partial group would make IPC and the miss rates meaningless */
+            while (i-- > 0)
+                close(__ctf_perf_fds[i]);
+            for (i = 0; i < __CTF_PERF_HW_EVENTS; i++)
+                __ctf_perf_fds[i] = -1;
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+#ifdef __CTF_POSIX
+static void __CTF_PERF_USAGE(struct rusage *usage)
+{
+#ifdef RUSAGE_THREAD
+    getrusage(RUSAGE_THREAD, usage);
+#else
+    getrusage(RUSAGE_SELF, usage);
+#endif
+}
+
+static __CTF_THREAD_LOCAL struct rusage __ctf_perf_usage;
+#endif
+
+/* Called right before the test function */
+static void __CTF_PERF_BEGIN(void)
+{
+    if (!__ctf_perf)
+        return;
+#ifdef __CTF_POSIX
+    __CTF_PERF_USAGE(&__ctf_perf_usage);
+#endif
+#ifdef __CTF_HAS_PERF_EVENT
+    if (__CTF_PERF_OPEN())
+    {
+        ioctl(__ctf_perf_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(__ctf_perf_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+/* Called right after the test function returned or was jumped out of */
+static void __CTF_PERF_END(__CTF_Perf_Stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (!__ctf_perf)
+        return;
+#ifdef __CTF_HAS_PERF_EVENT
+    if (__ctf_perf_fds[0] >= 0)
+    {
+        /* nr, time enabled, time running, then one value per event */
+        unsigned long long values[3 + __CTF_PERF_HW_EVENTS];
+        ioctl(__ctf_perf_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        if (read(__ctf_perf_fds[0], values, sizeof(values)) == (ssize_t)sizeof(values) && values[2] > 0)
+        {
+            /* Scale up if the group was multiplexed with other users of the PMU */
+            double scale = (double)values[1] / (double)values[2];
+            stats->hardware = true;
+            stats->cycles = (unsigned long long)(values[3] * scale);
+            stats->instructions = (unsigned long long)(values[4] * scale);
+            stats->cache_misses = (unsigned long long)(values[5] * scale);
+            stats->branch_misses = (unsigned long long)(values[6] * scale);
+        }
+    }
+#endif
+#ifdef __CTF_POSIX
+    struct rusage usage;
+    __CTF_PERF_USAGE(&usage);
+    stats->page_faults = (unsigned long long)((usage.ru_minflt - __ctf_perf_usage.ru_minflt) + (usage.ru_majflt - __ctf_perf_usage.ru_majflt));
+    stats->context_switches = (unsigned long long)((usage.ru_nvcsw - __ctf_perf_usage.ru_nvcsw) + (usage.ru_nivcsw - __ctf_perf_usage.ru_nivcsw));
+    /* Peak RSS is only tracked for the whole process */
+    struct rusage process;
+    getrusage(RUSAGE_SELF, &process);
+#ifdef __APPLE__
+    stats->peak_rss_kb = (unsigned long long)process.ru_maxrss / 1024;
+#else
+    stats->peak_rss_kb = (unsigned long long)process.ru_maxrss;
+#endif
+#endif
+}
+
+/* Closes the counters of a worker thread before it exits */
+static __CTF_MAYBE_UNUSED void __CTF_PERF_RELEASE(void)
+{
+#ifdef __CTF_HAS_PERF_EVENT
+    int i;
+    for (i = 0; i < __CTF_PERF_HW_EVENTS; i++)
+    {
+        if (__ctf_perf_fds[i] >= 0)
+            close(__ctf_perf_fds[i]);
+        __ctf_perf_fds[i] = -2;
+    }
+#endif
+}
+
+/*
+    Baselines.
+
+    --save-baseline writes the timing samples of every passing test to a text file, one "Suite/Test<TAB>count<TAB>
+    samples..." line each, in seconds. --compare-baseline reads such a file back and runs a two sided Mann-Whitney U
+    test between the stored and the new samples of each test. A test regressed (or improved) when the difference is
+    significant at --threshold and its median moved by at least --min-change percent. Any regression makes the
+    process exit with 1.
+
+    Plain tests are rerun to get --samples samples, so their side effects happen that many times as well. Benchmarks
+    already take many samples, so their per operation times are used instead. Under --isolate the reruns happen in
+    the test's process, which sends the samples back to the runner with its result.
+*/
+
+/* Newton's method, so using the framework doesn't require linking libm */
+static double __CTF_SQRT(double x)
+{
+    if (x <= 0)
+        return 0;
+    double r = x > 1 ? x : 1, last = 0;
+    int i;
+    for (i = 0; i < 200 && r != last; i++)
+    {
+        last = r;
+        r = (r + x / r) / 2;
+    }
+    return r;
+}
+
+static int __CTF_DOUBLE_COMPARE(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+
+#define __CTF_BASELINE_NONE 0
+#define __CTF_BASELINE_NEW 1
+#define __CTF_BASELINE_UNCHANGED 2
+#define __CTF_BASELINE_IMPROVED 3
+#define __CTF_BASELINE_REGRESSED 4
+
+#define __CTF_MAX_SAMPLES 1000
+
+typedef struct
+{
+    char *name;
+    int count;
+    double *samples;
+} __CTF_Baseline_Entry;
+
+typedef struct
+{
+    __CTF_Baseline_Entry *entries;
+    int count;
+    int capacity;
+} __CTF_Baseline;
+
+/* Set with --save-baseline, --compare-baseline, --samples, --threshold and --min-change */
+static const char *__ctf_save_baseline = NULL;
+static const char *__ctf_compare_baseline = NULL;
+static int __ctf_baseline_samples = 10;
+static double __ctf_baseline_alpha = 0.05;
+static double __ctf_baseline_min_change = 2.0;
+
+static __CTF_Baseline __ctf_baseline_old = {NULL, 0, 0};
+static __CTF_Baseline __ctf_baseline_new = {NULL, 0, 0};
+static int __ctf_baseline_regressions = 0;
+
+#ifdef __CTF_POSIX
+static pthread_mutex_t __ctf_baseline_lock = PTHREAD_MUTEX_INITIALIZER;
+#define __CTF_BASELINE_LOCK() pthread_mutex_lock(&__ctf_baseline_lock)
+#define __CTF_BASELINE_UNLOCK() pthread_mutex_unlock(&__ctf_baseline_lock)
+#else
+#define __CTF_BASELINE_LOCK()
+#define __CTF_BASELINE_UNLOCK()
+#endif
+
+/* Benchmarks hand their samples over through this when the runner wants them */
+static __CTF_THREAD_LOCAL double *__ctf_sample_sink = NULL;
+static __CTF_THREAD_LOCAL int __ctf_sample_sink_count = 0;
+
+#define __CTF_BASELINE_ACTIVE() (__ctf_save_baseline != NULL || __ctf_compare_baseline != NULL)
+
+static bool __CTF_BASELINE_ADD(__CTF_Baseline *baseline, const char *name, size_t name_length, const double *samples, int count)
+{
+    if (baseline->count >= baseline->capacity)
+    {
+        int capacity = baseline->capacity ? baseline->capacity * 2 : 64;
+        __CTF_Baseline_Entry *entries = (__CTF_Baseline_Entry *)realloc(baseline->entries, capacity * sizeof(__CTF_Baseline_Entry));
+        if (!entries)
+            return false;
+        baseline->entries = entries;
+        baseline->capacity = capacity;
+    }
+    __CTF_Baseline_Entry *entry = &baseline->entries[baseline->count];
+    entry->name = (char *)malloc(name_length + 1);
+    entry->samples = (double *)malloc(count * sizeof(double));
+    if (!entry->name || !entry->samples)
+    {
+        free(entry->name);
+        free(entry->samples);
+        return false;
+    }
+    memcpy(entry->name, name, name_length);
+    entry->name[name_length] = '\0';
+    memcpy(entry->samples, samples, count * sizeof(double));
+    entry->count = count;
+    baseline->count++;
+    return true;
+}
+
+static const __CTF_Baseline_Entry *__CTF_BASELINE_FIND(const __CTF_Baseline *baseline, const char *suite, const char *test)
+{
+    size_t suite_length = strlen(suite);
+    int i;
+    for (i = 0; i < baseline->count; i++)
+    {
+        const char *name = baseline->entries[i].name;
+        if (strncmp(name, suite, suite_length) == 0 && name[suite_length] == '/' && strcmp(name + suite_length + 1, test) == 0)
+            return &baseline->entries[i];
+    }
+    return NULL;
+}
+
+static void __CTF_BASELINE_LOAD(const char *filename)
+{
+    FILE *file = fopen(filename, "r");
+    if (!file)
+    {
+        __CTF_LOG("%sCould not open baseline \"%s\", every test will count as new.%s", __CTF_ANSI_RED, filename, __CTF_ANSI_RESET);
+        return;
+    }
+    static char line[65536];
+    double samples[__CTF_MAX_SAMPLES];
+    while (fgets(line, sizeof(line), file))
+    {
+        char *tab = strchr(line, '\t');
+        if (line[0] == '#' || !tab)
+            continue;
+        char *cursor = tab + 1, *end;
+        long count = strtol(cursor, &end, 10);
+        int read = 0;
+        cursor = end;
+        while (read < count && read < __CTF_MAX_SAMPLES)
+        {
+            samples[read] = strtod(cursor, &end);
+            if (end == cursor)
+                break;
+            cursor = end;
+            read++;
+        }
+        if (read > 0)
+            __CTF_BASELINE_ADD(&__ctf_baseline_old, line, tab - line, samples, read);
+    }
+    fclose(file);
+}
+
+static void __CTF_BASELINE_SAVE(const char *filename)
+{
+    FILE *file = fopen(filename, "w");
+    int i, j;
+    if (!file)
+    {
+        __CTF_LOG("%sCould not write baseline \"%s\".%s", __CTF_ANSI_RED, filename, __CTF_ANSI_RESET);
+        return;
+    }
+    fputs("# CTF baseline: Suite/Test, sample count, samples in seconds\n", file);
+    for (i = 0; i < __ctf_baseline_new.count; i++)
+    {
+        const __CTF_Baseline_Entry *entry = &__ctf_baseline_new.entries[i];
+        fprintf(file, "%s\t%d", entry->name, entry->count);
+        for (j = 0; j < entry->count; j++)
+            fprintf(file, " %.6g", entry->samples[j]);
+        fputc('\n', file);
+    }
+    fclose(file);
+}
+
+/* e^x for x <= 0, enough for the normal tail below without linking libm */
+static double __CTF_EXP_NEGATIVE(double x)
+{
+    if (x < -700)
+        return 0;
+    /* e^x = (e^(x/2^k))^(2^k) with x/2^k small enough for a short series */
+    int k = 0;
+    while (x < -0.5)
+    {
+        x /= 2;
+        k++;
+    }
+    double term = 1, sum = 1;
+    int i;
+    for (i = 1; i < 20; i++)
+    {
+        term *= x / i;
+        sum += term;
+    }
+    while (k-- > 0)
+        sum *= sum;
+    return sum;
+}
+
+/* Complementary error function, Numerical Recipes' erfcc with a relative error below 1.2e-7 */
+static double __CTF_ERFC(double x)
+{
+    double z = x < 0 ? -x : x;
+    double t = 1 / (1 + z / 2);
+    double r = t * __CTF_EXP_NEGATIVE(-z * z - 1.26551223 +
+                                      t * (1.00002368 + t * (0.37409196 + t * (0.09678418 + t * (-0.18628806 + t * (0.27886807 +
+                                      t * (-1.13520398 + t * (1.48851587 + t * (-0.82215223 + t * 0.17087277)))))))));
+    return x >= 0 ? r : 2 - r;
+}
+
+typedef struct
+{
+    double value;
+    int group;
+} __CTF_Ranked_Sample;
+
+static int __CTF_RANKED_COMPARE(const void *a, const void *b)
+{
+    double x = ((const __CTF_Ranked_Sample *)a)->value, y = ((const __CTF_Ranked_Sample *)b)->value;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Two sided Mann-Whitney U test with the normal approximation, corrected for ties and continuity.
+ *
+ * @return The p value, 1 if there is nothing to compare.
+ */
+static double __CTF_MANN_WHITNEY(const double *a, int n1, const double *b, int n2)
+{
+    int n = n1 + n2, i, j;
+    __CTF_Ranked_Sample *all = (__CTF_Ranked_Sample *)malloc(n * sizeof(__CTF_Ranked_Sample));
+    if (!all || n1 == 0 || n2 == 0)
+    {
+        free(all);
+        return 1;
+    }
+    for (i = 0; i < n1; i++)
+        all[i] = (__CTF_Ranked_Sample){a[i], 0};
+    for (i = 0; i < n2; i++)
+        all[n1 + i] = (__CTF_Ranked_Sample){b[i], 1};
+    qsort(all, n, sizeof(__CTF_Ranked_Sample), __CTF_RANKED_COMPARE);
+    double rank_sum = 0, ties = 0;
+    for (i = 0; i < n; i = j)
+    {
+        for (j = i + 1; j < n && all[j].value == all[i].value; j++)
+            ;
+        /* Ranks are 1 based, a run of ties shares the average of its ranks */
+        double rank = (i + 1 + j) / 2.0, t = j - i;
+        ties += t * t * t - t;
+        int k;
+        for (k = i; k < j; k++)
+        {
+            if (all[k].group == 0)
+                rank_sum += rank;
+        }
+    }
+    free(all);
+    double u = rank_sum - n1 * (n1 + 1) / 2.0, mean = n1 * (double)n2 / 2;
+    double variance = n1 * (double)n2 / 12 * ((n + 1) - ties / ((double)n * (n - 1)));
+    if (variance <= 0)
+        return 1;
+    double z = (u > mean ? u - mean - 0.5 : mean - u - 0.5) / __CTF_SQRT(variance);
+    if (z < 0)
+        z = 0;
+    return __CTF_ERFC(z / __CTF_SQRT(2));
+}
+
+static double __CTF_MEDIAN(const double *samples, int count)
+{
+    double sorted[__CTF_MAX_SAMPLES];
+    if (count > __CTF_MAX_SAMPLES)
+        count = __CTF_MAX_SAMPLES;
+    memcpy(sorted, samples, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), __CTF_DOUBLE_COMPARE);
+    return count % 2 ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+}
+
+/* Stores the samples of a passing test and classifies them against the old baseline */
+static void __CTF_BASELINE_RECORD(const __CTF_Test *test, const double *samples, int count, __CTF_Test_Result *result)
+{
+    const char *suite = test->suite_name ? test->suite_name : "";
+    __CTF_BASELINE_LOCK();
+    if (__ctf_save_baseline)
+    {
+        char name[512];
+        int length = snprintf(name, sizeof(name), "%s/%s", suite, test->test_name);
+        if (length > 0 && (size_t)length < sizeof(name))
+            __CTF_BASELINE_ADD(&__ctf_baseline_new, name, length, samples, count);
+    }
+    const __CTF_Baseline_Entry *old = __ctf_compare_baseline ? __CTF_BASELINE_FIND(&__ctf_baseline_old, suite, test->test_name) : NULL;
+    __CTF_BASELINE_UNLOCK();
+    if (!__ctf_compare_baseline)
+        return;
+    if (!old)
+    {
+        result->baseline = __CTF_BASELINE_NEW;
+        return;
+    }
+    double old_median = __CTF_MEDIAN(old->samples, old->count), new_median = __CTF_MEDIAN(samples, count);
+    result->baseline_change = old_median > 0 ? (new_median - old_median) / old_median * 100 : 0;
+    result->baseline_p = __CTF_MANN_WHITNEY(old->samples, old->count, samples, count);
+    if (result->baseline_p >= __ctf_baseline_alpha || (result->baseline_change < 0 ? -result->baseline_change : result->baseline_change) < __ctf_baseline_min_change)
+        result->baseline = __CTF_BASELINE_UNCHANGED;
+    else if (result->baseline_change > 0)
+        result->baseline = __CTF_BASELINE_REGRESSED;
+    else
+        result->baseline = __CTF_BASELINE_IMPROVED;
+}
+
+static const char *__CTF_BASELINE_NAME(int baseline)
+{
+    switch (baseline)
+    {
+    case __CTF_BASELINE_NEW:
+        return "new";
+    case __CTF_BASELINE_UNCHANGED:
+        return "unchanged";
+    case __CTF_BASELINE_IMPROVED:
+        return "improved";
+    case __CTF_BASELINE_REGRESSED:
+        return "regressed";
+    default:
+        return "none";
+    }
+}
+
+/* Writes --save-baseline and tells the process exit code, 1 if anything regressed */
+static int __CTF_BASELINE_FINISH(void)
+{
+    if (__ctf_save_baseline)
+        __CTF_BASELINE_SAVE(__ctf_save_baseline);
+    if (__ctf_compare_baseline && __ctf_baseline_regressions > 0)
+    {
+        __CTF_LOG("%s%d test(s) regressed against the baseline \"%s\".%s", __CTF_ANSI_RED, __ctf_baseline_regressions, __ctf_compare_baseline, __CTF_ANSI_RESET);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+    Bulk assertions.
+
+    CTF_ASSERT_MEM_EQ, CTF_ASSERT_ARRAY_EQ and CTF_ASSERT_ARRAY_NEAR run a comparison kernel over the whole buffers and
+    only branch once on its result. The kernels use AVX2 when the cpu has it, SSE2 or NEON otherwise and plain loops
+    everywhere else. All of the failure output lives in __CTF_BULK_FAIL, which is cold and never inlined, so an
+    assertion site is a call and a compare.
+*/
+
+/* Scalar tails and fallbacks, all kernels take and return byte offsets */
+static size_t __CTF_MISMATCH_BYTES_SCALAR(const unsigned char *a, const unsigned char *b, size_t i, size_t size)
+{
+    while (i + sizeof(unsigned long long) <= size)
+    {
+        unsigned long long x, y;
+        memcpy(&x, a + i, sizeof x);
+        memcpy(&y, b + i, sizeof y);
+        if (x != y)
+            break;
+        i += sizeof x;
+    }
+    for (; i < size; i++)
+    {
+        if (a[i] != b[i])
+            return i;
+    }
+    return size;
+}
+
+/* Equal values (infinities included) always match, NaN never does */
+#define __CTF_NEAR(x, y, eps) ((x) == (y) || ((x) - (y) <= (eps) && (y) - (x) <= (eps)))
+
+static size_t __CTF_MISMATCH_FLOAT_SCALAR(const float *a, const float *b, size_t i, size_t count, float eps)
+{
+    for (; i < count; i++)
+    {
+        if (!__CTF_NEAR(a[i], b[i], eps))
+            return i;
+    }
+    return count;
+}
+
+static size_t __CTF_MISMATCH_DOUBLE_SCALAR(const double *a, const double *b, size_t i, size_t count, double eps)
+{
+    for (; i < count; i++)
+    {
+        if (!__CTF_NEAR(a[i], b[i], eps))
+            return i;
+    }
+    return count;
+}
+
+#ifdef __CTF_HAS_AVX2_DISPATCH
+__attribute__((target("avx2"))) static size_t __CTF_MISMATCH_BYTES_AVX2(const unsigned char *a, const unsigned char *b, size_t size)
+{
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64)
+    {
+        __m256i x0 = _mm256_loadu_si256((const __m256i *)(a + i)), y0 = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i x1 = _mm256_loadu_si256((const __m256i *)(a + i + 32)), y1 = _mm256_loadu_si256((const __m256i *)(b + i + 32));
+        __m256i same = _mm256_and_si256(_mm256_cmpeq_epi8(x0, y0), _mm256_cmpeq_epi8(x1, y1));
+        if ((unsigned int)_mm256_movemask_epi8(same) != 0xffffffffu)
+            break;
+    }
+    for (; i + 32 <= size; i += 32)
+    {
+        unsigned int same = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                                                                  _mm256_loadu_si256((const __m256i *)(b + i))));
+        if (same != 0xffffffffu)
+            return i + (size_t)__builtin_ctz(~same);
+    }
+    return __CTF_MISMATCH_BYTES_SCALAR(a, b, i, size);
+}
+
+__attribute__((target("avx2"))) static size_t __CTF_MISMATCH_FLOAT_AVX2(const float *a, const float *b, size_t count, float eps)
+{
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)), limit = _mm256_set1_ps(eps);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(a + i), y = _mm256_loadu_ps(b + i);
+        __m256 diff = _mm256_and_ps(_mm256_sub_ps(x, y), abs_mask);
+        __m256 near = _mm256_or_ps(_mm256_cmp_ps(diff, limit, _CMP_LE_OQ), _mm256_cmp_ps(x, y, _CMP_EQ_OQ));
+        unsigned int ok = (unsigned int)_mm256_movemask_ps(near);
+        if (ok != 0xffu)
+            return i + (size_t)__builtin_ctz(~ok);
+    }
+    return __CTF_MISMATCH_FLOAT_SCALAR(a, b, i, count, eps);
+}
+
+__attribute__((target("avx2"))) static size_t __CTF_MISMATCH_DOUBLE_AVX2(const double *a, const double *b, size_t count, double eps)
+{
+    const __m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffll)), limit = _mm256_set1_pd(eps);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256d x = _mm256_loadu_pd(a + i), y = _mm256_loadu_pd(b + i);
+        __m256d diff = _mm256_and_pd(_mm256_sub_pd(x, y), abs_mask);
+        __m256d near = _mm256_or_pd(_mm256_cmp_pd(diff, limit, _CMP_LE_OQ), _mm256_cmp_pd(x, y, _CMP_EQ_OQ));
+        unsigned int ok = (unsigned int)_mm256_movemask_pd(near);
+        if (ok != 0xfu)
+            return i + (size_t)__builtin_ctz(~ok);
+    }
+    return __CTF_MISMATCH_DOUBLE_SCALAR(a, b, i, count, eps);
+}
+
+/* -1 not checked yet */
+static int __ctf_has_avx2 = -1;
+
+static bool __CTF_USE_AVX2(void)
+{
+    if (__ctf_has_avx2 < 0)
+        __ctf_has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    return __ctf_has_avx2 == 1;
+}
+#endif
+
+__CTF_API __CTF_MAYBE_UNUSED size_t __CTF_MISMATCH_BYTES(const void *a_ptr, const void *b_ptr, size_t size)
+{
+    const unsigned char *a = (const unsigned char *)a_ptr, *b = (const unsigned char *)b_ptr;
+    size_t i = 0;
+    if (a == b)
+        return size;
+#ifdef __CTF_HAS_AVX2_DISPATCH
+    if (size >= 64 && __CTF_USE_AVX2())
+        return __CTF_MISMATCH_BYTES_AVX2(a, b, size);
+#endif
+#if defined(__CTF_HAS_SSE2)
+    for (; i + 16 <= size; i += 16)
+    {
+        unsigned int same = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i)),
+                                                                            _mm_loadu_si128((const __m128i *)(b + i))));
+        if (same != 0xffffu)
+            return i + (size_t)__builtin_ctz(~same);
+    }
+#elif defined(__CTF_HAS_NEON)
+    for (; i + 16 <= size; i += 16)
+    {
+        /* Lanes are all ones where equal, so the minimum is zero as soon as one byte differs */
+        if (vminvq_u8(vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i))) != 0xff)
+            break;
+    }
+#endif
+    return __CTF_MISMATCH_BYTES_SCALAR(a, b, i, size);
+}
+
+__CTF_API __CTF_MAYBE_UNUSED size_t __CTF_MISMATCH_FLOAT(const void *a_ptr, const void *b_ptr, size_t size, float eps)
+{
+    const float *a = (const float *)a_ptr, *b = (const float *)b_ptr;
+    size_t count = size / sizeof(float), i = 0;
+#ifdef __CTF_HAS_AVX2_DISPATCH
+    if (count >= 16 && __CTF_USE_AVX2())
+        return __CTF_MISMATCH_FLOAT_AVX2(a, b, count, eps) * sizeof(float);
+#endif
+#if defined(__CTF_HAS_SSE2)
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)), limit = _mm_set1_ps(eps);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(a + i), y = _mm_loadu_ps(b + i);
+        __m128 near = _mm_or_ps(_mm_cmple_ps(_mm_and_ps(_mm_sub_ps(x, y), abs_mask), limit), _mm_cmpeq_ps(x, y));
+        unsigned int ok = (unsigned int)_mm_movemask_ps(near);
+        if (ok != 0xfu)
+            return (i + (size_t)__builtin_ctz(~ok)) * sizeof(float);
+    }
+#elif defined(__CTF_HAS_NEON)
+    const float32x4_t limit = vdupq_n_f32(eps);
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t x = vld1q_f32(a + i), y = vld1q_f32(b + i);
+        uint32x4_t near = vorrq_u32(vcleq_f32(vabdq_f32(x, y), limit), vceqq_f32(x, y));
+        if (vminvq_u32(near) == 0)
+            break;
+    }
+#endif
+    return __CTF_MISMATCH_FLOAT_SCALAR(a, b, i, count, eps) * sizeof(float);
+}
+
+__CTF_API __CTF_MAYBE_UNUSED size_t __CTF_MISMATCH_DOUBLE(const void *a_ptr, const void *b_ptr, size_t size, double eps)
+{
+    const double *a = (const double *)a_ptr, *b = (const double *)b_ptr;
+    size_t count = size / sizeof(double), i = 0;
+#ifdef __CTF_HAS_AVX2_DISPATCH
+    if (count >= 8 && __CTF_USE_AVX2())
+        return __CTF_MISMATCH_DOUBLE_AVX2(a, b, count, eps) * sizeof(double);
+#endif
+#if defined(__CTF_HAS_SSE2)
+    const __m128d abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffll)), limit = _mm_set1_pd(eps);
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128d x = _mm_loadu_pd(a + i), y = _mm_loadu_pd(b + i);
+        __m128d near = _mm_or_pd(_mm_cmple_pd(_mm_and_pd(_mm_sub_pd(x, y), abs_mask), limit), _mm_cmpeq_pd(x, y));
+        unsigned int ok = (unsigned int)_mm_movemask_pd(near);
+        if (ok != 0x3u)
+            return (i + (size_t)__builtin_ctz(~ok)) * sizeof(double);
+    }
+#elif defined(__CTF_HAS_NEON)
+    const float64x2_t limit = vdupq_n_f64(eps);
+    for (; i + 2 <= count; i += 2)
+    {
+        float64x2_t x = vld1q_f64(a + i), y = vld1q_f64(b + i);
+        uint64x2_t near = vorrq_u64(vcleq_f64(vabdq_f64(x, y), limit), vceqq_f64(x, y));
+        if ((vgetq_lane_u64(near, 0) & vgetq_lane_u64(near, 1)) == 0)
+            break;
+    }
+#endif
+    return __CTF_MISMATCH_DOUBLE_SCALAR(a, b, i, count, eps) * sizeof(double);
+}
+
+static size_t __CTF_FORMAT_VALUE(char *buffer, size_t offset, const unsigned char *element, size_t size, int kind)
+{
+    if (kind == __CTF_VALUE_FLOAT && size == sizeof(float))
+    {
+        float value;
+        memcpy(&value, element, sizeof value);
+        return __CTF_LOG_FORMAT_ARGS(buffer, offset, "%.9g", value);
+    }
+    if (kind == __CTF_VALUE_DOUBLE && size == sizeof(double))
+    {
+        double value;
+        memcpy(&value, element, sizeof value);
+        return __CTF_LOG_FORMAT_ARGS(buffer, offset, "%.17g", value);
+    }
+    if ((kind == __CTF_VALUE_SIGNED || kind == __CTF_VALUE_UNSIGNED) && (size == 1 || size == 2 || size == 4 || size == 8))
+    {
+        unsigned long long bits = 0;
+        signed char c;
+        short h;
+        int w;
+        long long q;
+        switch (size)
+        {
+        case 1:
+            memcpy(&c, element, 1);
+            bits = kind == __CTF_VALUE_SIGNED ? (unsigned long long)(long long)c : (unsigned char)c;
+            break;
+        case 2:
+            memcpy(&h, element, 2);
+            bits = kind == __CTF_VALUE_SIGNED ? (unsigned long long)(long long)h : (unsigned short)h;
+            break;
+        case 4:
+            memcpy(&w, element, 4);
+            bits = kind == __CTF_VALUE_SIGNED ? (unsigned long long)(long long)w : (unsigned int)w;
+            break;
+        default:
+            memcpy(&q, element, 8);
+            bits = (unsigned long long)q;
+        }
+        if (kind == __CTF_VALUE_SIGNED)
+            return __CTF_LOG_FORMAT_ARGS(buffer, offset, "%lld", (long long)bits);
+        return __CTF_LOG_FORMAT_ARGS(buffer, offset, "%llu", bits);
+    }
+    offset = __CTF_LOG_FORMAT_ARGS(buffer, offset, "0x");
+    size_t i;
+    for (i = 0; i < size && i < 32; i++)
+        offset = __CTF_LOG_FORMAT_ARGS(buffer, offset, "%02x", element[i]);
+    return offset;
+}
+
+/* Sixteen bytes per line around the mismatch, differing bytes in red */
+static size_t __CTF_HEXDUMP(char *buffer, size_t offset, const char *label, const unsigned char *data, const unsigned char *other,
+                            size_t begin, size_t end)
+{
+    size_t line, i;
+    for (line = begin; line < end; line += 16)
+    {
+        offset = __CTF_LOG_FORMAT_ARGS(buffer, offset, "\n\t\t%s %08zx ", label, line);
+        for (i = line; i < line + 16; i++)
+        {
+            if (i >= end)
+                offset = __CTF_LOG_FORMAT_ARGS(buffer, offset, "   ");
+            else if (data[i] != other[i])
+                offset = __CTF_LOG_FORMAT_ARGS(buffer, offset, " %s%02x%s", __CTF_ANSI_RED, data[i], __CTF_ANSI_RESET);
+            else
+                offset = __CTF_LOG_FORMAT_ARGS(buffer, offset, " %02x", data[i]);
+        }
+        offset = __CTF_LOG_FORMAT_ARGS(buffer, offset, "  |");
+        for (i = line; i < line + 16 && i < end; i++)
+            offset = __CTF_LOG_FORMAT_ARGS(buffer, offset, "%c", data[i] >= 0x20 && data[i] < 0x7f ? data[i] : '.');
+        offset = __CTF_LOG_FORMAT_ARGS(buffer, offset, "|");
+    }
+    return offset;
+}
+
+/**
+ * @brief Logs a failed bulk assertion: where the first mismatch is, both values and a hexdump of both buffers around it.
+ *
+ * @note The test still has to return, the assertion macro does that after this.
+ */
+__CTF_API __CTF_COLD __CTF_MAYBE_UNUSED void __CTF_BULK_FAIL(const char *a_text, const char *b_text, const void *a_ptr, const void *b_ptr, size_t size,
+                                                              size_t at, size_t element_size, int kind, double eps, const char *file, int line)
+{
+    const unsigned char *a = (const unsigned char *)a_ptr, *b = (const unsigned char *)b_ptr;
+    char text[__CTF_LOG_BUFFER_SIZE];
+    size_t index = at / element_size, length;
+    length = __CTF_LOG_FORMAT_ARGS(text, 0, "\n\t%sAssertion failed:%s\n\t\t%s and %s differ at index %zu of %zu:\n\t\t%s[%zu] = ",
+                                   __CTF_ANSI_RED, __CTF_ANSI_RESET, a_text, b_text, index, size / element_size, a_text, index);
+    length = __CTF_FORMAT_VALUE(text, length, a + at, element_size, kind);
+    length = __CTF_LOG_FORMAT_ARGS(text, length, "\n\t\t%s[%zu] = ", b_text, index);
+    length = __CTF_FORMAT_VALUE(text, length, b + at, element_size, kind);
+    if (eps != 0)
+        length = __CTF_LOG_FORMAT_ARGS(text, length, "\n\t\ttolerance: %g", eps);
+    /* One line before the mismatch and two from it, clamped to the buffers */
+    size_t begin = (at & ~(size_t)15) >= 16 ? (at & ~(size_t)15) - 16 : 0, end = (at & ~(size_t)15) + 32;
+    if (end > size)
+        end = size;
+    length = __CTF_HEXDUMP(text, length, "a", a, b, begin, end);
+    length = __CTF_HEXDUMP(text, length, "b", b, a, begin, end);
+    text[length] = '\0';
+    __CTF_LOG("%s", text);
+    __CTF_LOG("\n\t%sFail in Suite:%s\"%s\"%s, Test:%s\"%s\"%s:%s\n\t\tfile: %s\n\t\tline: %d",
+              __CTF_ANSI_RED, __CTF_ANSI_YELLOW, __ctf_current_test_suite_name, __CTF_ANSI_RED, __CTF_ANSI_YELLOW, __ctf_current_test_name,
+              __CTF_ANSI_RED, __CTF_ANSI_RESET, file, line);
+}
+
+/*
+    Test arena.
+
+    CTF_ALLOC hands out scratch memory from a per thread bump allocator that the runner resets after every test,
+    however it ended, so tests don't need cleanup code for it. Chunks are never given back while the thread runs
+    tests, a reset only rewinds to the first chunk, so later tests reuse the same warm memory.
+*/
+
+#define __CTF_ARENA_CHUNK_SIZE (64 * 1024)
+#define __CTF_ARENA_ALIGN 16
+
+typedef struct __CTF_Arena_Chunk
+{
+    struct __CTF_Arena_Chunk *next;
+    size_t size;
+    size_t used;
+    /* Keeps data aligned to __CTF_ARENA_ALIGN */
+    _Alignas(__CTF_ARENA_ALIGN) unsigned char data[];
+} __CTF_Arena_Chunk;
+
+static __CTF_THREAD_LOCAL __CTF_Arena_Chunk *__ctf_arena_first = NULL;
+static __CTF_THREAD_LOCAL __CTF_Arena_Chunk *__ctf_arena_current = NULL;
+
+static __CTF_Arena_Chunk *__CTF_ARENA_NEW_CHUNK(size_t size)
+{
+#ifdef __CTF_ALLOC_TRACKING
+    /* Arena chunks outlive the test, they are not its allocations */
+    bool tracking = __ctf_alloc_active;
+    __ctf_alloc_active = false;
+#endif
+    __CTF_TIMEOUT_DEFER();
+    __CTF_Arena_Chunk *chunk = (__CTF_Arena_Chunk *)malloc(sizeof(__CTF_Arena_Chunk) + size);
+    __CTF_TIMEOUT_RESUME();
+#ifdef __CTF_ALLOC_TRACKING
+    __ctf_alloc_active = tracking;
+#endif
+    if (!chunk)
+        return NULL;
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+/**
+ * @brief Returns size bytes aligned to 16 from the test arena, NULL if out of memory. Don't free it.
+ *
+ */
+__CTF_API __CTF_MAYBE_UNUSED void *__CTF_ARENA_ALLOC(size_t size)
+{
+    size = (size + __CTF_ARENA_ALIGN - 1) & ~(size_t)(__CTF_ARENA_ALIGN - 1);
+    __CTF_Arena_Chunk *chunk = __ctf_arena_current;
+    if (chunk && chunk->size - chunk->used >= size)
+    {
+        void *ptr = chunk->data + chunk->used;
+        chunk->used += size;
+        return ptr;
+    }
+    /* Move on to the chunk kept from an earlier test, or put a new one in front of it if it is too small */
+    if (chunk && chunk->next && chunk->next->size >= size)
+    {
+        chunk = chunk->next;
+        chunk->used = 0;
+    }
+    else
+    {
+        size_t chunk_size = chunk && chunk->size * 2 > __CTF_ARENA_CHUNK_SIZE ? chunk->size * 2 : __CTF_ARENA_CHUNK_SIZE;
+        __CTF_Arena_Chunk *fresh = __CTF_ARENA_NEW_CHUNK(size > chunk_size ? size : chunk_size);
+        if (!fresh)
+            return NULL;
+        if (chunk)
+        {
+            fresh->next = chunk->next;
+            chunk->next = fresh;
+        }
+        else
+        {
+            fresh->next = __ctf_arena_first;
+            __ctf_arena_first = fresh;
+        }
+        chunk = fresh;
+    }
+    __ctf_arena_current = chunk;
+    chunk->used = size;
+    return chunk->data;
+}
+
+/* Rewinds the arena of the calling thread, everything CTF_ALLOC returned so far becomes invalid */
+__CTF_API void __CTF_ARENA_RESET(void)
+{
+    __ctf_arena_current = __ctf_arena_first;
+    if (__ctf_arena_current)
+        __ctf_arena_current->used = 0;
+}
+
+/* Frees the chunks of a worker thread before it exits */
+static __CTF_MAYBE_UNUSED void __CTF_ARENA_RELEASE(void)
+{
+    while (__ctf_arena_first)
+    {
+        __CTF_Arena_Chunk *next = __ctf_arena_first->next;
+        free(__ctf_arena_first);
+        __ctf_arena_first = next;
+    }
+    __ctf_arena_current = NULL;
+}
+
+/*
+    Tracing (--trace).
+
+    --trace writes a Chrome trace event file at process exit, which Perfetto and chrome://tracing show as a timeline
+    with one track per thread. Suites and tests are recorded as complete events, CTF_SPAN adds a region lasting until
+    the end of the enclosing scope and CTF_COUNTER a sample of a counter track. Events go into chunks owned by the
+    recording thread, so recording takes no lock, and a full chunk is published with a single CAS. Without --trace
+    CTF_SPAN and CTF_COUNTER only check a flag. Names are kept by pointer, use string literals.
+*/
+
+#define __CTF_TRACE_CHUNK_EVENTS 4096
+
+typedef struct
+{
+    const char *name;
+    const char *category;
+    unsigned long long start;
+    /* Duration in nanoseconds of a complete event, the sample of a counter */
+    long long value;
+    char phase;
+    /* Track of an event sent back by an isolated test, 0 for the chunk's */
+    int thread;
+} __CTF_Trace_Event;
+
+typedef struct __CTF_Trace_Chunk
+{
+    struct __CTF_Trace_Chunk *next;
+    int thread;
+    int count;
+    __CTF_Trace_Event events[__CTF_TRACE_CHUNK_EVENTS];
+} __CTF_Trace_Chunk;
+
+/* Set with --trace */
+static const char *__ctf_trace_file = NULL;
+__CTF_API bool __ctf_trace = false;
+
+static unsigned long long __ctf_trace_origin = 0;
+static _Atomic(__CTF_Trace_Chunk *) __ctf_trace_chunks = NULL;
+static _Atomic int __ctf_trace_threads = 0;
+static __CTF_THREAD_LOCAL __CTF_Trace_Chunk *__ctf_trace_chunk = NULL;
+static __CTF_THREAD_LOCAL int __ctf_trace_thread = 0;
+
+static __CTF_Trace_Event *__CTF_TRACE_EVENT(void)
+{
+    __CTF_Trace_Chunk *chunk = __ctf_trace_chunk;
+    if (__CTF_UNLIKELY(!chunk || chunk->count == __CTF_TRACE_CHUNK_EVENTS))
+    {
+        if (!__ctf_trace_thread)
+            __ctf_trace_thread = atomic_fetch_add(&__ctf_trace_threads, 1) + 1;
+#ifdef __CTF_ALLOC_TRACKING
+        /* Trace chunks are not the test's allocations */
+        bool tracking = __ctf_alloc_active;
+        __ctf_alloc_active = false;
+#endif
+        __CTF_TIMEOUT_DEFER();
+        chunk = (__CTF_Trace_Chunk *)malloc(sizeof(__CTF_Trace_Chunk));
+        __CTF_TIMEOUT_RESUME();
+#ifdef __CTF_ALLOC_TRACKING
+        __ctf_alloc_active = tracking;
+#endif
+        if (!chunk)
+            return NULL;
+        chunk->thread = __ctf_trace_thread;
+        chunk->count = 0;
+        chunk->next = atomic_load(&__ctf_trace_chunks);
+        while (!atomic_compare_exchange_weak(&__ctf_trace_chunks, &chunk->next, chunk))
+            ;
+        __ctf_trace_chunk = chunk;
+    }
+    return &chunk->events[chunk->count++];
+}
+
+/* Records a region of the calling thread from start to end, in __CTF_NOW_NS time */
+static void __CTF_TRACE_COMPLETE(const char *name, const char *category, unsigned long long start, unsigned long long end)
+{
+    __CTF_Trace_Event *event = __CTF_TRACE_EVENT();
+    if (!event)
+        return;
+    event->name = name;
+    event->category = category;
+    event->start = start;
+    event->value = (long long)(end - start);
+    event->phase = 'X';
+    event->thread = 0;
+}
+
+__CTF_API __CTF_MAYBE_UNUSED void __CTF_TRACE_COUNTER(const char *name, long long value)
+{
+    __CTF_Trace_Event *event = __CTF_TRACE_EVENT();
+    if (!event)
+        return;
+    event->name = name;
+    event->category = "counter";
+    event->start = __CTF_NOW_NS();
+    event->value = value;
+    event->phase = 'C';
+    event->thread = 0;
+}
+
+__CTF_API __CTF_MAYBE_UNUSED void __CTF_TRACE_SPAN_END(__CTF_Trace_Span *span)
+{
+    if (span->start)
+        __CTF_TRACE_COMPLETE(span->name, "span", span->start, __CTF_NOW_NS());
+}
+
+static void __CTF_REPORT_ESCAPED(FILE *file, const char *text, bool json);
+
+/* Writes every recorded event to --trace, timestamps are microseconds since the process was initialized */
+static void __CTF_TRACE_FINISH(void)
+{
+    if (!__ctf_trace)
+        return;
+    FILE *file = fopen(__ctf_trace_file, "w");
+    if (!file)
+    {
+        __CTF_LOG("%sCould not write the trace \"%s\".%s", __CTF_ANSI_RED, __ctf_trace_file, __CTF_ANSI_RESET);
+        return;
+    }
+#ifdef __CTF_POSIX
+    int pid = (int)getpid();
+#else
+    int pid = 1;
+#endif
+    bool first = true;
+    const __CTF_Trace_Chunk *chunk;
+    int i;
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+    for (chunk = atomic_load(&__ctf_trace_chunks); chunk; chunk = chunk->next)
+    {
+        for (i = 0; i < chunk->count; i++)
+        {
+            const __CTF_Trace_Event *event = &chunk->events[i];
+            int thread = event->thread ? event->thread : chunk->thread;
+            double ts = (double)(long long)(event->start - __ctf_trace_origin) / 1e3;
+            fputs(first ? "\n{\"name\":\"" : ",\n{\"name\":\"", file);
+            first = false;
+            __CTF_REPORT_ESCAPED(file, event->name, true);
+            fputs("\",\"cat\":\"", file);
+            __CTF_REPORT_ESCAPED(file, event->category, true);
+            if (event->phase == 'X')
+            {
+                fprintf(file, "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}", ts, (double)event->value / 1e3, pid, thread);
+            }
+            else
+            {
+                fprintf(file, "\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"", ts, pid, thread);
+                __CTF_REPORT_ESCAPED(file, event->name, true);
+                fprintf(file, "\":%lld}}", event->value);
+            }
+        }
+    }
+    fputs("\n]}\n", file);
+    fclose(file);
+}
+
+/*
+    Result cache.
+
+    Runs with --cache, --failed-first, --last-failed or --incremental record the outcome of each test they ran in a
+    small text file (ctf.cache unless --cache names another), one "Suite/Test<TAB>status<TAB>fingerprint<TAB>seconds"
+    line each. Other runs neither read nor write it. The seconds are averaged with the previous run's to smooth out
+    noise. Entries of tests that didn't run are kept, so several test binaries or filtered runs can
+    share the file. The fingerprint is a hash of the test binary, or under ctf-runner of the module the test came
+    from, so any rebuild that changes the code invalidates every result recorded by the older build.
+
+    --failed-first moves the tests that failed last time to the front of their suite, --last-failed runs only those
+    (or everything if nothing failed) and --incremental skips tests that passed with the current fingerprint.
+*/
+
+/* Set with --cache, --no-cache, --failed-first, --last-failed and --incremental, other runs don't touch the cache */
+static const char *__ctf_cache_file = "ctf.cache";
+static bool __ctf_cache_enabled = false;
+static bool __ctf_failed_first = false;
+static bool __ctf_last_failed = false;
+static bool __ctf_incremental = false;
+/* Set with --shard-history F, a result cache that is only ever read */
+static const char *__ctf_shard_history_file = NULL;
+
+/* argv[0], the fallback for hashing the binary where /proc/self/exe doesn't exist */
+static const char *__ctf_program_path = NULL;
+
+typedef struct
+{
+    char *name;
+    int status;
+    unsigned long long fingerprint;
+    double elapsed;
+} __CTF_Cache_Entry;
+
+/* Open addressing table keyed by "Suite/Test", only touched from the thread running the suites */
+static __CTF_Cache_Entry *__ctf_cache = NULL;
+static size_t __ctf_cache_capacity = 0;
+static size_t __ctf_cache_count = 0;
+static bool __ctf_cache_loaded = false;
+static bool __ctf_cache_dirty = false;
+static bool __ctf_cache_has_failures = false;
+static int __ctf_cache_skipped = 0;
+
+static unsigned long long __ctf_fingerprint = 0;
+static bool __ctf_fingerprint_ready = false;
+
+#define __CTF_CACHE_SELECTING() (__ctf_cache_enabled && (__ctf_failed_first || __ctf_last_failed || __ctf_incremental))
+
+static unsigned long long __CTF_CACHE_HASH(const char *suite, const char *test)
+{
+    unsigned long long hash = 0xcbf29ce484222325ull;
+    for (; *suite; suite++)
+        hash = (hash ^ (unsigned char)*suite) * 0x100000001b3ull;
+    hash = (hash ^ '/') * 0x100000001b3ull;
+    for (; *test; test++)
+        hash = (hash ^ (unsigned char)*test) * 0x100000001b3ull;
+    return hash;
+}
+
+static bool __CTF_CACHE_MATCH(const char *name, const char *suite, const char *test)
+{
+    size_t suite_length = strlen(suite);
+    return strncmp(name, suite, suite_length) == 0 && name[suite_length] == '/' && strcmp(name + suite_length + 1, test) == 0;
+}
+
+/**
+ * @brief Finds the entry of a test, or the empty slot it would go in when insert is set.
+ *
+ * @return NULL if there is no entry, or no memory for a new one.
+ */
+static __CTF_Cache_Entry *__CTF_CACHE_SLOT(const char *suite, const char *test, bool insert)
+{
+    if (insert && (__ctf_cache_count + 1) * 2 > __ctf_cache_capacity)
+    {
+        size_t capacity = __ctf_cache_capacity ? __ctf_cache_capacity * 2 : 256, i;
+        __CTF_Cache_Entry *table = (__CTF_Cache_Entry *)calloc(capacity, sizeof(__CTF_Cache_Entry));
+        if (!table)
+            return NULL;
+        for (i = 0; i < __ctf_cache_capacity; i++)
+        {
+            __CTF_Cache_Entry *entry = &__ctf_cache[i];
+            if (!entry->name)
+                continue;
+            /* Names hold exactly one '/' after the suite, so the key can be hashed in one go */
+            unsigned long long hash = 0xcbf29ce484222325ull;
+            const char *c;
+            for (c = entry->name; *c; c++)
+                hash = (hash ^ (unsigned char)*c) * 0x100000001b3ull;
+            size_t slot = (size_t)hash & (capacity - 1);
+            while (table[slot].name)
+                slot = (slot + 1) & (capacity - 1);
+            table[slot] = *entry;
+        }
+        free(__ctf_cache);
+        __ctf_cache = table;
+        __ctf_cache_capacity = capacity;
+    }
+    if (__ctf_cache_capacity == 0)
+        return NULL;
+    size_t slot = (size_t)__CTF_CACHE_HASH(suite, test) & (__ctf_cache_capacity - 1);
+    while (__ctf_cache[slot].name)
+    {
+        if (__CTF_CACHE_MATCH(__ctf_cache[slot].name, suite, test))
+            return &__ctf_cache[slot];
+        slot = (slot + 1) & (__ctf_cache_capacity - 1);
+    }
+    if (!insert)
+        return NULL;
+    size_t suite_length = strlen(suite), test_length = strlen(test);
+    char *name = (char *)malloc(suite_length + test_length + 2);
+    if (!name)
+        return NULL;
+    memcpy(name, suite, suite_length);
+    name[suite_length] = '/';
+    memcpy(name + suite_length + 1, test, test_length + 1);
+    __ctf_cache[slot].name = name;
+    __ctf_cache[slot].status = __CTF_TEST_PASSED;
+    __ctf_cache[slot].fingerprint = 0;
+    __ctf_cache[slot].elapsed = 0;
+    __ctf_cache_count++;
+    return &__ctf_cache[slot];
+}
+
+/**
+ * @brief Reads a whole line of any length into *line, growing it as needed.
+ *
+ * @return false at the end of the file or when out of memory.
+ */
+static bool __CTF_READ_LINE(FILE *file, char **line, size_t *capacity)
+{
+    size_t length = 0;
+    for (;;)
+    {
+        if (*capacity - length < 2)
+        {
+            size_t grown_capacity = *capacity ? *capacity * 2 : 256;
+            char *grown = (char *)realloc(*line, grown_capacity);
+            if (!grown)
+                return false;
+            *line = grown;
+            *capacity = grown_capacity;
+        }
+        if (!fgets(*line + length, (int)(*capacity - length), file))
+            return length > 0;
+        length += strlen(*line + length);
+        if (length > 0 && (*line)[length - 1] == '\n')
+            return true;
+    }
+}
+
+/**
+ * @brief Splits a "Suite/Test, status, fingerprint, seconds" line in place, line is left holding the suite name.
+ *
+ * @return false for comments and malformed lines.
+ */
+static bool __CTF_CACHE_PARSE(char *line, char **test, int *status, unsigned long long *fingerprint, double *elapsed)
+{
+    char *slash = strchr(line, '/'), *tab = strchr(line, '\t');
+    if (line[0] == '#' || !slash || !tab || slash > tab)
+        return false;
+    *slash = '\0';
+    *tab = '\0';
+    char *cursor = tab + 1, *end;
+    *status = (int)strtol(cursor, &end, 10);
+    if (end == cursor)
+        return false;
+    *test = slash + 1;
+    *fingerprint = strtoull(end, &end, 16);
+    *elapsed = strtod(end, NULL);
+    return true;
+}
+
+static void __CTF_CACHE_LOAD(void)
+{
+    if (__ctf_cache_loaded || !__ctf_cache_enabled)
+        return;
+    __ctf_cache_loaded = true;
+    FILE *file = fopen(__ctf_cache_file, "r");
+    if (!file)
+        return;
+    char *line = NULL;
+    size_t capacity = 0;
+    while (__CTF_READ_LINE(file, &line, &capacity))
+    {
+        char *test;
+        int status;
+        unsigned long long fingerprint;
+        double elapsed;
+        if (!__CTF_CACHE_PARSE(line, &test, &status, &fingerprint, &elapsed))
+            continue;
+        __CTF_Cache_Entry *entry = __CTF_CACHE_SLOT(line, test, true);
+        if (!entry)
+            break;
+        entry->status = status;
+        entry->fingerprint = fingerprint;
+        entry->elapsed = elapsed;
+        if (status != __CTF_TEST_PASSED)
+            __ctf_cache_has_failures = true;
+    }
+    free(line);
+    fclose(file);
+}
+
+/* Hashes a file eight bytes per step, 0 if it can't be read, which never matches an entry */
+static unsigned long long __CTF_FINGERPRINT_FILE(FILE *file)
+{
+    if (!file)
+        return 0;
+    static unsigned long long block[8192];
+    unsigned long long hash = 0xcbf29ce484222325ull, total = 0;
+    size_t read;
+    while ((read = fread(block, 1, sizeof(block), file)) > 0)
+    {
+        size_t words = (read + 7) / 8, i;
+        memset((unsigned char *)block + read, 0, words * 8 - read);
+        for (i = 0; i < words; i++)
+        {
+            hash = (hash ^ block[i]) * 0x100000001b3ull;
+            hash ^= hash >> 29;
+        }
+        total += read;
+    }
+    fclose(file);
+    hash = (hash ^ total) * 0x100000001b3ull;
+    return hash ? hash : 1;
+}
+
+/**
+ * @brief Fingerprint of the code under test, the test binary hashed once. ctf-runner sets it to the module it runs.
+ *
+ */
+static unsigned long long __CTF_FINGERPRINT(void)
+{
+    if (__ctf_fingerprint_ready)
+        return __ctf_fingerprint;
+    __ctf_fingerprint_ready = true;
+    FILE *file = fopen("/proc/self/exe", "rb");
+    if (!file && __ctf_program_path)
+        file = fopen(__ctf_program_path, "rb");
+    __ctf_fingerprint = __CTF_FINGERPRINT_FILE(file);
+    return __ctf_fingerprint;
+}
+
+/**
+ * @brief Where a test goes in the plan according to the cache.
+ *
+ * @return -1 to skip it, 1 if it failed last time, 0 otherwise.
+ */
+static int __CTF_CACHE_RANK(const char *suite, const char *test)
+{
+    __CTF_Cache_Entry *entry = __CTF_CACHE_SLOT(suite, test, false);
+    bool failed = entry && entry->status != __CTF_TEST_PASSED;
+    if (__ctf_last_failed && __ctf_cache_has_failures && !failed)
+        return -1;
+    if (__ctf_incremental && entry && !failed && entry->fingerprint == __CTF_FINGERPRINT() && entry->fingerprint != 0)
+        return -1;
+    return failed ? 1 : 0;
+}
+
+static void __CTF_CACHE_RECORD(const char *suite, const char *test, const __CTF_Test_Result *result)
+{
+    if (!__ctf_cache_enabled)
+        return;
+    __CTF_CACHE_LOAD();
+    __CTF_Cache_Entry *entry = __CTF_CACHE_SLOT(suite, test, true);
+    if (!entry)
+        return;
+    entry->status = result->status;
+#ifdef CTF_RUNNER
+    /* Modules have a fingerprint each, the one at exit is only that of the last one run */
+    entry->fingerprint = __CTF_FINGERPRINT();
+#else
+    entry->fingerprint = 0;
+#endif
+    entry->elapsed = entry->elapsed > 0 ? (entry->elapsed + result->elapsed) / 2 : result->elapsed;
+    __ctf_cache_dirty = true;
+}
+
+/* Writes the cache next to the old one and renames it over, so an interrupted run never leaves half a file */
+static void __CTF_CACHE_FINISH(void)
+{
+    if (__ctf_cache_skipped > 0)
+        __CTF_LOG("Skipped %d test(s) according to the result cache \"%s\".", __ctf_cache_skipped, __ctf_cache_file);
+    if (!__ctf_cache_dirty)
+        return;
+    /* Every node has to keep seeing the same history */
+    if (__ctf_shard_history_file && strcmp(__ctf_shard_history_file, __ctf_cache_file) == 0)
+        return;
+    char temp_name[4096];
+    snprintf(temp_name, sizeof(temp_name), "%s.tmp", __ctf_cache_file);
+    FILE *file = fopen(temp_name, "w");
+    if (!file)
+    {
+        __CTF_LOG("%sCould not write the result cache \"%s\".%s", __CTF_ANSI_RED, __ctf_cache_file, __CTF_ANSI_RESET);
+        return;
+    }
+    unsigned long long fingerprint = __CTF_FINGERPRINT();
+    size_t i;
+    fputs("# CTF result cache: Suite/Test, status, binary fingerprint, seconds\n", file);
+    for (i = 0; i < __ctf_cache_capacity; i++)
+    {
+        const __CTF_Cache_Entry *entry = &__ctf_cache[i];
+        if (entry->name)
+            fprintf(file, "%s\t%d\t%016llx\t%.6g\n", entry->name, entry->status, entry->fingerprint ? entry->fingerprint : fingerprint, entry->elapsed);
+    }
+    if (fclose(file) != 0 || rename(temp_name, __ctf_cache_file) != 0)
+    {
+        remove(temp_name);
+        __CTF_LOG("%sCould not write the result cache \"%s\".%s", __CTF_ANSI_RED, __ctf_cache_file, __CTF_ANSI_RESET);
+    }
+}
+
+/*
+    Sharding and scheduling.
+
+    --shard i/N runs the i-th of N disjoint parts of the selected tests, so a test binary can be spread over N CI
+    nodes. The split may only depend on what every node sees alike, so it never looks at the result cache, which
+    each node rewrites on its own. By default a test goes to the shard picked by a stable hash of its name. With
+    --shard-history F, a result cache saved by an earlier run and shared by all nodes, the tests of each suite with
+    a duration in F are instead packed longest first onto the shard with the least time so far, and the rest are
+    hashed. F is read once at startup and never written.
+
+    When a suite runs on several threads the tests with the longest recorded duration are started first, so a long
+    test picked up last doesn't leave the other workers idle at the end.
+*/
+
+/* Set with --shard i/N, this process runs __ctf_shard of __ctf_shards, counted from 0 */
+static int __ctf_shard = 0;
+static int __ctf_shards = 1;
+
+typedef struct
+{
+    unsigned long long key;
+    double duration;
+} __CTF_Shard_Duration;
+
+/* Durations of --shard-history sorted by the hash of "Suite/Test" */
+static __CTF_Shard_Duration *__ctf_shard_history = NULL;
+static size_t __ctf_shard_history_count = 0;
+
+typedef struct
+{
+    int index;
+    int position;
+    double duration;
+} __CTF_Scheduled_Test;
+
+/* Recorded seconds of a test, -1 if the cache has none */
+static double __CTF_CACHE_DURATION(const char *suite, const char *test)
+{
+    __CTF_Cache_Entry *entry = __CTF_CACHE_SLOT(suite, test, false);
+    return entry ? entry->elapsed : -1;
+}
+
+static int __CTF_SHARD_HISTORY_COMPARE(const void *a, const void *b)
+{
+    unsigned long long x = ((const __CTF_Shard_Duration *)a)->key, y = ((const __CTF_Shard_Duration *)b)->key;
+    return x < y ? -1 : x > y;
+}
+
+/* Reads --shard-history, a node that can't would split differently from the others so the process stops instead */
+static void __CTF_SHARD_HISTORY_LOAD(const char *filename)
+{
+    FILE *file = fopen(filename, "r");
+    if (!file)
+    {
+        fprintf(stderr, "Could not read the shard history \"%s\".\n", filename);
+        exit(2);
+    }
+    size_t capacity = 0, line_capacity = 0;
+    char *line = NULL;
+    while (__CTF_READ_LINE(file, &line, &line_capacity))
+    {
+        char *test;
+        int status;
+        unsigned long long fingerprint;
+        double elapsed;
+        if (!__CTF_CACHE_PARSE(line, &test, &status, &fingerprint, &elapsed))
+            continue;
+        if (__ctf_shard_history_count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 256;
+            __CTF_Shard_Duration *grown = (__CTF_Shard_Duration *)realloc(__ctf_shard_history, capacity * sizeof(__CTF_Shard_Duration));
+            if (!grown)
+            {
+                fprintf(stderr, "Could not read the shard history \"%s\".\n", filename);
+                exit(2);
+            }
+            __ctf_shard_history = grown;
+        }
+        __ctf_shard_history[__ctf_shard_history_count].key = __CTF_CACHE_HASH(line, test);
+        __ctf_shard_history[__ctf_shard_history_count].duration = elapsed;
+        __ctf_shard_history_count++;
+    }
+    free(line);
+    fclose(file);
+    qsort(__ctf_shard_history, __ctf_shard_history_count, sizeof(__CTF_Shard_Duration), __CTF_SHARD_HISTORY_COMPARE);
+}
+
+/* Seconds of a test in --shard-history, -1 if it has none */
+static double __CTF_SHARD_DURATION(const char *suite, const char *test)
+{
+    __CTF_Shard_Duration key, *found;
+    key.key = __CTF_CACHE_HASH(suite, test);
+    found = (__CTF_Shard_Duration *)bsearch(&key, __ctf_shard_history, __ctf_shard_history_count, sizeof(__CTF_Shard_Duration), __CTF_SHARD_HISTORY_COMPARE);
+    return found ? found->duration : -1;
+}
+
+/* Longest first, tests without a duration last, ties keep their order so every node sorts the same way */
+static int __CTF_SCHEDULE_COMPARE(const void *a, const void *b)
+{
+    const __CTF_Scheduled_Test *x = (const __CTF_Scheduled_Test *)a, *y = (const __CTF_Scheduled_Test *)b;
+    if (x->duration != y->duration)
+        return x->duration < y->duration ? 1 : -1;
+    return x->position - y->position;
+}
+
+static __CTF_Scheduled_Test *__CTF_SCHEDULE_SORT(const __CTF_Test_Suite *suite, const int *order, int count, double (*duration)(const char *, const char *))
+{
+    __CTF_Scheduled_Test *scheduled = (__CTF_Scheduled_Test *)malloc(count * sizeof(__CTF_Scheduled_Test));
+    int i;
+    if (!scheduled)
+        return NULL;
+    for (i = 0; i < count; i++)
+    {
+        scheduled[i].index = order[i];
+        scheduled[i].position = i;
+        scheduled[i].duration = duration(suite->name, suite->tests[order[i]].test_name);
+    }
+    qsort(scheduled, count, sizeof(__CTF_Scheduled_Test), __CTF_SCHEDULE_COMPARE);
+    return scheduled;
+}
+
+/**
+ * @brief Keeps the tests of order that belong to this process's shard, in the same order. order must be in link
+ * order, the split of a suite then only depends on its selected tests and the shard history.
+ *
+ * @return The new count.
+ */
+static int __CTF_SHARD_SELECT(const __CTF_Test_Suite *suite, int *order, int count)
+{
+    char *mine = (char *)calloc(suite->count, 1);
+    /* Estimated seconds packed onto each shard, starting over with every suite */
+    double *loads = __ctf_shard_history_count > 0 ? (double *)calloc(__ctf_shards, sizeof(double)) : NULL;
+    __CTF_Scheduled_Test *scheduled = loads ? __CTF_SCHEDULE_SORT(suite, order, count, __CTF_SHARD_DURATION) : NULL;
+    int i, j, kept = 0;
+    if (!mine || (loads && !scheduled))
+    {
+        /* Falling back to the hash here could differ from the other nodes, so run everything rather than miss tests */
+        free(scheduled);
+        free(loads);
+        free(mine);
+        return count;
+    }
+    for (i = 0; i < count; i++)
+    {
+        int index = scheduled ? scheduled[i].index : order[i];
+        int shard;
+        if (scheduled && scheduled[i].duration >= 0)
+        {
+            /* Longest processing time first onto the least loaded shard */
+            shard = 0;
+            for (j = 1; j < __ctf_shards; j++)
+            {
+                if (loads[j] < loads[shard])
+                    shard = j;
+            }
+            loads[shard] += scheduled[i].duration;
+        }
+        else
+        {
+            shard = (int)(__CTF_CACHE_HASH(suite->name, suite->tests[index].test_name) % (unsigned long long)__ctf_shards);
+        }
+        mine[index] = shard == __ctf_shard;
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (mine[order[i]])
+            order[kept++] = order[i];
+    }
+    free(scheduled);
+    free(loads);
+    free(mine);
+    return kept;
+}
+
+/* Reorders the plan longest recorded duration first */
+static bool __CTF_SCHEDULE_LONGEST_FIRST(const __CTF_Test_Suite *suite, int *order, int count)
+{
+    __CTF_Scheduled_Test *scheduled = __CTF_SCHEDULE_SORT(suite, order, count, __CTF_CACHE_DURATION);
+    int i;
+    if (!scheduled)
+        return false;
+    for (i = 0; i < count; i++)
+        order[i] = scheduled[i].index;
+    free(scheduled);
+    return true;
+}
+
+/*
+    Repeated runs.
+
+    --repeat N runs the selected tests N times and --until-fail stops repeating after the first pass with a failure
+    (or only then, without --repeat). --shuffle runs every pass in a new order, both the tests within a suite and the
+    suites run by CTF_RUN_SUITES or CTF_RUN_REGISTERED, drawn from the process seed and the pass number so
+    --seed replays the same orders. Suites run by CTF_SUITE_RUN from main are repeated one at a time instead, since
+    the order they are called in belongs to main.
+
+    Only the first pass prints banners, suite headers and passing results, so later passes cost little more than
+    the tests themselves. Each result is folded into a per test record of runs, failures, signals and a running
+    mean and variance of its time, which is printed when the process exits. Ctrl-C ends the run after the current
+    pass so the record still gets printed, a second one ends it right away.
+*/
+
+/* Set with --repeat, --until-fail and --shuffle, 0 passes meaning until interrupted or a failure */
+static unsigned long long __ctf_repeat = 1;
+static bool __ctf_until_fail = false;
+static bool __ctf_shuffle = false;
+
+/* Set from the first pass on while the suite loops drive the passes, the suites then run their tests once */
+static bool __ctf_repeat_outer = false;
+static unsigned long long __ctf_iteration = 0;
+static unsigned long long __ctf_iterations_ran = 0;
+static bool __ctf_repeat_failed = false;
+static volatile sig_atomic_t __ctf_repeat_interrupted = 0;
+/* Set for every pass after the first, the reporters and suite banners stay silent for passing tests */
+__CTF_API bool __ctf_quiet = false;
+
+#define __CTF_REPEATING() (!__ctf_list_only && (__ctf_repeat != 1 || __ctf_until_fail || __ctf_shuffle))
+
+typedef struct
+{
+    char *name;
+    unsigned long long hash;
+    unsigned long long runs;
+    unsigned long long failures;
+    unsigned long long signals;
+    unsigned long long timeouts;
+    unsigned long long first_failure;
+    /* Welford's running mean and sum of squared differences of the elapsed seconds */
+    double mean;
+    double m2;
+    double min;
+    double max;
+} __CTF_Repeat_Stats;
+
+/* Open addressing table keyed by "Suite/Test" like the result cache, only touched from the thread running the suites */
+static __CTF_Repeat_Stats *__ctf_repeat_stats = NULL;
+static size_t __ctf_repeat_stats_capacity = 0;
+static size_t __ctf_repeat_stats_count = 0;
+
+/* Set with --seed, otherwise picked once per process */
+static unsigned long long __ctf_seed = 0;
+static bool __ctf_seed_set = false;
+
+#ifdef __CTF_POSIX
+static pthread_once_t __ctf_seed_once = PTHREAD_ONCE_INIT;
+#endif
+
+typedef struct
+{
+    unsigned long long s[4];
+} __CTF_Rng;
+
+static unsigned long long __CTF_SPLITMIX64(unsigned long long *state)
+{
+    unsigned long long z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static void __CTF_SEED_PICK(void)
+{
+    if (__ctf_seed_set)
+        return;
+    unsigned long long state = __CTF_NOW_NS() ^ (unsigned long long)time(NULL) << 20;
+#ifdef __CTF_POSIX
+    state ^= (unsigned long long)getpid() << 40;
+#endif
+    __ctf_seed = __CTF_SPLITMIX64(&state);
+    __ctf_seed_set = true;
+}
+
+/* The process seed, the same for every thread */
+static unsigned long long __CTF_SEED(void)
+{
+#ifdef __CTF_POSIX
+    pthread_once(&__ctf_seed_once, __CTF_SEED_PICK);
+#else
+    __CTF_SEED_PICK();
+#endif
+    return __ctf_seed;
+}
+
+/* Seeds a stream from the process seed and a name, so each test gets its own reproducible sequence */
+static void __CTF_RNG_SEED(__CTF_Rng *rng, unsigned long long seed, const char *name)
+{
+    /* FNV-1a */
+    unsigned long long hash = 0xcbf29ce484222325ull;
+    for (; *name; name++)
+        hash = (hash ^ (unsigned char)*name) * 0x100000001b3ull;
+    unsigned long long state = seed ^ hash;
+    int i;
+    for (i = 0; i < 4; i++)
+        rng->s[i] = __CTF_SPLITMIX64(&state);
+}
+
+/* xoshiro256** */
+static inline unsigned long long __CTF_RNG_NEXT(__CTF_Rng *rng)
+{
+    unsigned long long *s = rng->s;
+    unsigned long long x = s[1] * 5, result = ((x << 7) | (x >> 57)) * 9, t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+/* Uniform in [0, range), 0 meaning the full 64 bit range. Lemire's multiply and shift, close enough to unbiased */
+static inline unsigned long long __CTF_RNG_BELOW(__CTF_Rng *rng, unsigned long long range)
+{
+    unsigned long long r = __CTF_RNG_NEXT(rng);
+    if (range == 0)
+        return r;
+#ifdef __SIZEOF_INT128__
+    return (unsigned long long)(((unsigned __int128)r * range) >> 64);
+#else
+    return r % range;
+#endif
+}
+
+/* Fisher-Yates over order, the stream is seeded from the process seed, the pass and name so --seed replays it */
+static void __CTF_SHUFFLE(int *order, int count, unsigned long long iteration, const char *name)
+{
+    __CTF_Rng rng;
+    int i;
+    __CTF_RNG_SEED(&rng, __CTF_SEED() + iteration, name);
+    for (i = count - 1; i > 0; i--)
+    {
+        int j = (int)__CTF_RNG_BELOW(&rng, (unsigned long long)i + 1);
+        int swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+}
+
+static void __CTF_REPEAT_INTERRUPT(int sig)
+{
+    (void)sig;
+    __ctf_repeat_interrupted = 1;
+}
+
+/* Lets the first Ctrl-C end the run after the current pass, the handler resets itself so a second one kills it */
+static void __CTF_REPEAT_INTERRUPTIBLE(void)
+{
+#ifdef __CTF_POSIX
+    struct sigaction interrupt;
+    memset(&interrupt, 0, sizeof(interrupt));
+    interrupt.sa_handler = __CTF_REPEAT_INTERRUPT;
+    interrupt.sa_flags = SA_RESETHAND;
+    sigemptyset(&interrupt.sa_mask);
+    sigaction(SIGINT, &interrupt, NULL);
+#else
+    signal(SIGINT, __CTF_REPEAT_INTERRUPT);
+#endif
+}
+
+/* Whether pass iteration, counted from 0, is due */
+static bool __CTF_REPEAT_CONTINUE(unsigned long long iteration)
+{
+    if (iteration == 0)
+        return true;
+    if (__ctf_repeat_interrupted || (__ctf_until_fail && __ctf_repeat_failed))
+        return false;
+    return __ctf_repeat == 0 || iteration < __ctf_repeat;
+}
+
+static void __CTF_REPEAT_BEGIN(unsigned long long iteration)
+{
+    __ctf_iteration = iteration;
+    __ctf_quiet = iteration > 0;
+    if (iteration >= __ctf_iterations_ran)
+        __ctf_iterations_ran = iteration + 1;
+}
+
+/**
+ * @brief Runs count suites pass after pass, run(suites, i) running the i-th. Each pass gets a new order with
+ * --shuffle.
+ *
+ */
+static void __CTF_REPEAT_SUITES(const void *suites, int count, void (*run)(const void *, int))
+{
+    int *order = (int *)malloc((count > 0 ? count : 1) * sizeof(int));
+    unsigned long long iteration;
+    int i;
+    if (!order)
+        return;
+    __ctf_repeat_outer = true;
+    for (iteration = 0; __CTF_REPEAT_CONTINUE(iteration); iteration++)
+    {
+        __CTF_REPEAT_BEGIN(iteration);
+        for (i = 0; i < count; i++)
+            order[i] = i;
+        if (__ctf_shuffle)
+            __CTF_SHUFFLE(order, count, iteration, "");
+        for (i = 0; i < count; i++)
+            run(suites, order[i]);
+    }
+    __ctf_repeat_outer = false;
+    __ctf_quiet = false;
+    free(order);
+}
+
+static __CTF_Repeat_Stats *__CTF_REPEAT_STATS_SLOT(const char *suite, const char *test)
+{
+    unsigned long long hash = __CTF_CACHE_HASH(suite, test);
+    size_t slot, i;
+    if ((__ctf_repeat_stats_count + 1) * 2 > __ctf_repeat_stats_capacity)
+    {
+        size_t capacity = __ctf_repeat_stats_capacity ? __ctf_repeat_stats_capacity * 2 : 256;
+        __CTF_Repeat_Stats *table = (__CTF_Repeat_Stats *)calloc(capacity, sizeof(__CTF_Repeat_Stats));
+        if (!table)
+            return NULL;
+        for (i = 0; i < __ctf_repeat_stats_capacity; i++)
+        {
+            if (!__ctf_repeat_stats[i].name)
+                continue;
+            slot = (size_t)__ctf_repeat_stats[i].hash & (capacity - 1);
+            while (table[slot].name)
+                slot = (slot + 1) & (capacity - 1);
+            table[slot] = __ctf_repeat_stats[i];
+        }
+        free(__ctf_repeat_stats);
+        __ctf_repeat_stats = table;
+        __ctf_repeat_stats_capacity = capacity;
+    }
+    slot = (size_t)hash & (__ctf_repeat_stats_capacity - 1);
+    while (__ctf_repeat_stats[slot].name)
+    {
+        if (__ctf_repeat_stats[slot].hash == hash && __CTF_CACHE_MATCH(__ctf_repeat_stats[slot].name, suite, test))
+            return &__ctf_repeat_stats[slot];
+        slot = (slot + 1) & (__ctf_repeat_stats_capacity - 1);
+    }
+    size_t suite_length = strlen(suite), test_length = strlen(test);
+    char *name = (char *)malloc(suite_length + test_length + 2);
+    if (!name)
+        return NULL;
+    memcpy(name, suite, suite_length);
+    name[suite_length] = '/';
+    memcpy(name + suite_length + 1, test, test_length + 1);
+    __ctf_repeat_stats[slot].name = name;
+    __ctf_repeat_stats[slot].hash = hash;
+    __ctf_repeat_stats_count++;
+    return &__ctf_repeat_stats[slot];
+}
+
+static void __CTF_REPEAT_RECORD(const char *suite, const char *test, const __CTF_Test_Result *result)
+{
+    if (result->status != __CTF_TEST_PASSED)
+        __ctf_repeat_failed = true;
+    if (!__CTF_REPEATING())
+        return;
+    __CTF_Repeat_Stats *stats = __CTF_REPEAT_STATS_SLOT(suite, test);
+    if (!stats)
+        return;
+    if (result->status != __CTF_TEST_PASSED && stats->failures++ == 0)
+        stats->first_failure = __ctf_iteration;
+    stats->signals += result->status == __CTF_TEST_SIGNALED;
+    stats->timeouts += result->status == __CTF_TEST_TIMED_OUT;
+    double delta = result->elapsed - stats->mean;
+    stats->runs++;
+    stats->mean += delta / (double)stats->runs;
+    stats->m2 += delta * (result->elapsed - stats->mean);
+    if (stats->runs == 1 || result->elapsed < stats->min)
+        stats->min = result->elapsed;
+    if (result->elapsed > stats->max)
+        stats->max = result->elapsed;
+}
+
+/* Most failures first, then by name */
+static int __CTF_REPEAT_STATS_COMPARE(const void *a, const void *b)
+{
+    const __CTF_Repeat_Stats *x = (const __CTF_Repeat_Stats *)a, *y = (const __CTF_Repeat_Stats *)b;
+    double x_rate = (double)x->failures / (double)x->runs, y_rate = (double)y->failures / (double)y->runs;
+    if (x_rate != y_rate)
+        return x_rate < y_rate ? 1 : -1;
+    return strcmp(x->name, y->name);
+}
+
+static void __CTF_REPEAT_FINISH(void)
+{
+    size_t i, count = 0;
+    if (!__CTF_REPEATING() || __ctf_repeat_stats_count == 0)
+        return;
+    __CTF_Repeat_Stats *stats = (__CTF_Repeat_Stats *)malloc(__ctf_repeat_stats_count * sizeof(__CTF_Repeat_Stats));
+    if (!stats)
+        return;
+    for (i = 0; i < __ctf_repeat_stats_capacity; i++)
+    {
+        if (__ctf_repeat_stats[i].name)
+            stats[count++] = __ctf_repeat_stats[i];
+    }
+    qsort(stats, count, sizeof(__CTF_Repeat_Stats), __CTF_REPEAT_STATS_COMPARE);
+    __CTF_LOG("\nRepeated %llu pass(es)%s%s.", __ctf_iterations_ran, __ctf_repeat_interrupted ? ", interrupted" : "",
+              __ctf_until_fail && __ctf_repeat_failed ? ", stopped at the first failing pass" : "");
+    for (i = 0; i < count; i++)
+    {
+        const __CTF_Repeat_Stats *entry = &stats[i];
+        double stddev = entry->runs > 1 ? __CTF_SQRT(entry->m2 / (double)(entry->runs - 1)) : 0;
+        const char *color = entry->failures == 0 ? __CTF_ANSI_GREEN : entry->failures < entry->runs ? __CTF_ANSI_YELLOW : __CTF_ANSI_RED;
+        __CTF_LOG("%s%-40s%s %llu runs, %llu failed (%.3f%%), %llu signaled, %llu timed out, %.3es +- %.2es [%.3es, %.3es]",
+                  color, entry->name, __CTF_ANSI_RESET, entry->runs, entry->failures,
+                  100.0 * (double)entry->failures / (double)entry->runs, entry->signals, entry->timeouts,
+                  entry->mean, stddev, entry->min, entry->max);
+        if (entry->failures > 0 && entry->failures < entry->runs)
+            __CTF_LOG("    %sflaky%s, first failed in pass %llu", __CTF_ANSI_YELLOW, __CTF_ANSI_RESET, entry->first_failure + 1);
+    }
+    if (__ctf_shuffle)
+        __CTF_LOG("Shuffled with seed %llu, rerun with --shuffle --seed %llu to replay the same orders.", __CTF_SEED(), __CTF_SEED());
+    free(stats);
+}
+
+/*
+    Test selection.
+
+    --filter takes comma separated "Suite/Test" globs ('*' and '?'), a pattern without '/' selects a whole suite and a
+    leading '-' excludes instead of selects. Patterns are split and classified once when parsing the arguments, so
+    most checks are a length compare and a memcmp. When a suite runs, the suite halves are matched once into a bit
+    mask and each test is then only checked against the patterns whose suite half matched.
+*/
+
+#define __CTF_MAX_FILTERS 64
+
+#define __CTF_GLOB_ANY 0
+#define __CTF_GLOB_EXACT 1
+#define __CTF_GLOB_PREFIX 2
+#define __CTF_GLOB_SUFFIX 3
+#define __CTF_GLOB_CONTAINS 4
+#define __CTF_GLOB_GENERAL 5
+
+typedef struct
+{
+    const char *text;
+    size_t length;
+    int kind;
+} __CTF_Glob;
+
+typedef struct
+{
+    __CTF_Glob suite;
+    __CTF_Glob test;
+    bool negative;
+} __CTF_Filter;
+
+static __CTF_Filter __ctf_filters[__CTF_MAX_FILTERS];
+static int __ctf_filter_count = 0;
+static bool __ctf_filter_has_positive = false;
+
+typedef struct
+{
+    /* Indices into the suite's tests in the order they should run, NULL for all of them in link order */
+    int *order;
+    int count;
+    /* Set when order is longest first, the threaded runner then deals it out so every worker starts on a long test */
+    bool longest_first;
+} __CTF_Run_Plan;
+
+#define __CTF_PLAN_AT(plan, position) ((plan)->order ? (plan)->order[position] : (position))
+
+static __CTF_Glob __CTF_GLOB_COMPILE(const char *text, size_t length)
+{
+    __CTF_Glob glob = {text, length, __CTF_GLOB_EXACT};
+    size_t i, stars = 0;
+    bool question = false;
+    for (i = 0; i < length; i++)
+    {
+        stars += text[i] == '*';
+        question |= text[i] == '?';
+    }
+    if (question || stars > 2)
+        glob.kind = __CTF_GLOB_GENERAL;
+    else if (stars == length)
+        glob.kind = __CTF_GLOB_ANY;
+    else if (stars == 1 && text[length - 1] == '*')
+        glob.kind = __CTF_GLOB_PREFIX, glob.length--;
+    else if (stars == 1 && text[0] == '*')
+        glob.kind = __CTF_GLOB_SUFFIX, glob.text++, glob.length--;
+    else if (stars == 2 && text[0] == '*' && text[length - 1] == '*')
+        glob.kind = __CTF_GLOB_CONTAINS, glob.text++, glob.length -= 2;
+    else if (stars)
+        glob.kind = __CTF_GLOB_GENERAL;
+    return glob;
+}
+
+/* Iterative wildcard match, backtracks only to the last '*' so it stays linear for typical patterns */
+static bool __CTF_GLOB_MATCH_GENERAL(const char *pattern, size_t pattern_length, const char *text)
+{
+    size_t p = 0, star = (size_t)-1;
+    const char *t = text, *star_text = NULL;
+    while (*t)
+    {
+        if (p < pattern_length && (pattern[p] == '?' || pattern[p] == *t))
+        {
+            p++;
+            t++;
+        }
+        else if (p < pattern_length && pattern[p] == '*')
+        {
+            star = p++;
+            star_text = t;
+        }
+        else if (star != (size_t)-1)
+        {
+            p = star + 1;
+            t = ++star_text;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern_length && pattern[p] == '*')
+        p++;
+    return p == pattern_length;
+}
+
+static bool __CTF_GLOB_MATCH(const __CTF_Glob *glob, const char *text)
+{
+    size_t length;
+    switch (glob->kind)
+    {
+    case __CTF_GLOB_ANY:
+        return true;
+    case __CTF_GLOB_EXACT:
+        return strlen(text) == glob->length && memcmp(text, glob->text, glob->length) == 0;
+    case __CTF_GLOB_PREFIX:
+        return strncmp(text, glob->text, glob->length) == 0;
+    case __CTF_GLOB_SUFFIX:
+        length = strlen(text);
+        return length >= glob->length && memcmp(text + length - glob->length, glob->text, glob->length) == 0;
+    case __CTF_GLOB_CONTAINS:
+    {
+        char needle[256];
+        if (glob->length >= sizeof needle)
+            return __CTF_GLOB_MATCH_GENERAL(glob->text - 1, glob->length + 2, text);
+        memcpy(needle, glob->text, glob->length);
+        needle[glob->length] = '\0';
+        return strstr(text, needle) != NULL;
+    }
+    default:
+        return __CTF_GLOB_MATCH_GENERAL(glob->text, glob->length, text);
+    }
+}
+
+/* Parses a comma separated list of patterns, the strings must outlive the run (argv does) */
+static void __CTF_FILTER_ADD(const char *patterns)
+{
+    while (*patterns)
+    {
+        const char *end = strchr(patterns, ',');
+        size_t length = end ? (size_t)(end - patterns) : strlen(patterns);
+        if (length > 0 && __ctf_filter_count < __CTF_MAX_FILTERS)
+        {
+            __CTF_Filter *filter = &__ctf_filters[__ctf_filter_count];
+            filter->negative = patterns[0] == '-';
+            const char *pattern = patterns + filter->negative;
+            size_t pattern_length = length - filter->negative;
+            const char *slash = (const char *)memchr(pattern, '/', pattern_length);
+            if (slash)
+            {
+                filter->suite = __CTF_GLOB_COMPILE(pattern, slash - pattern);
+                filter->test = __CTF_GLOB_COMPILE(slash + 1, pattern_length - (slash - pattern) - 1);
+            }
+            else
+            {
+                filter->suite = __CTF_GLOB_COMPILE(pattern, pattern_length);
+                filter->test = __CTF_GLOB_COMPILE("*", 1);
+            }
+            __ctf_filter_has_positive |= !filter->negative;
+            __ctf_filter_count++;
+        }
+        else if (length > 0)
+        {
+            fprintf(stderr, "Warning: only the first %d filters are used.\n", __CTF_MAX_FILTERS);
+        }
+        patterns += length + (end != NULL);
+    }
+}
+
+/* One bit per filter whose suite half matches the suite */
+static unsigned long long __CTF_FILTER_SUITE_MASK(const char *suite_name)
+{
+    unsigned long long mask = 0;
+    int i;
+    for (i = 0; i < __ctf_filter_count; i++)
+    {
+        if (__CTF_GLOB_MATCH(&__ctf_filters[i].suite, suite_name))
+            mask |= 1ull << i;
+    }
+    return mask;
+}
+
+static bool __CTF_FILTER_TEST(unsigned long long mask, const char *test_name)
+{
+    bool selected = !__ctf_filter_has_positive;
+    int i;
+    for (i = 0; mask; i++, mask >>= 1)
+    {
+        if (!(mask & 1) || (selected && !__ctf_filters[i].negative))
+            continue;
+        if (__CTF_GLOB_MATCH(&__ctf_filters[i].test, test_name))
+        {
+            if (__ctf_filters[i].negative)
+                return false;
+            selected = true;
+        }
+    }
+    return selected;
+}
+
+/**
+ * @brief Whether any test of the suite could be selected, so suites that are filtered out entirely are never even linked.
+ *
+ */
+static bool __CTF_FILTER_SUITE(const char *suite_name)
+{
+    unsigned long long mask = __CTF_FILTER_SUITE_MASK(suite_name);
+    bool selected = !__ctf_filter_has_positive;
+    int i;
+    for (i = 0; i < __ctf_filter_count; i++)
+    {
+        if (!(mask & (1ull << i)))
+            continue;
+        if (__ctf_filters[i].negative && __ctf_filters[i].test.kind == __CTF_GLOB_ANY)
+            return false;
+        selected |= !__ctf_filters[i].negative;
+    }
+    return selected;
+}
+
+/**
+ * @brief Picks the tests of a suite to run. Without filters or cache options nothing is allocated and every test runs
+ * in link order.
+ *
+ */
+static void __CTF_PLAN_SUITE(const __CTF_Test_Suite *suite, __CTF_Run_Plan *plan)
+{
+    plan->order = NULL;
+    plan->count = suite->count;
+    plan->longest_first = false;
+    bool selecting = __CTF_CACHE_SELECTING();
+    bool scheduling = __ctf_cache_enabled && __ctf_jobs > 1 && !__ctf_failed_first && !__ctf_shuffle;
+    if ((__ctf_filter_count == 0 && !selecting && !scheduling && __ctf_shards <= 1 && !__ctf_shuffle) || suite->count == 0)
+        return;
+    int *order = (int *)malloc(suite->count * sizeof(int));
+    if (!order)
+        return;
+    __CTF_CACHE_LOAD();
+    unsigned long long mask = __CTF_FILTER_SUITE_MASK(suite->name);
+    int i, count = 0, failed = 0;
+    for (i = 0; i < suite->count; i++)
+    {
+        if (__CTF_FILTER_TEST(mask, suite->tests[i].test_name))
+            order[count++] = i;
+    }
+    /* Sharding only looks at the filters and the shard history, so nodes run with the same ones split the same tests */
+    if (__ctf_shards > 1)
+        count = __CTF_SHARD_SELECT(suite, order, count);
+    plan->count = 0;
+    for (i = 0; i < count; i++)
+    {
+        int index = order[i];
+        const char *test_name = suite->tests[index].test_name;
+        int rank = selecting ? __CTF_CACHE_RANK(suite->name, test_name) : 0;
+        if (rank < 0)
+        {
+            __ctf_cache_skipped++;
+            continue;
+        }
+        /* Failed tests are inserted behind the earlier failed ones, so both groups keep link order */
+        if (rank > 0 && __ctf_failed_first)
+        {
+            memmove(order + failed + 1, order + failed, (plan->count - failed) * sizeof(int));
+            order[failed++] = index;
+        }
+        else
+        {
+            order[plan->count] = index;
+        }
+        plan->count++;
+    }
+    if (scheduling && plan->count > 1)
+        plan->longest_first = __CTF_SCHEDULE_LONGEST_FIRST(suite, order, plan->count);
+    plan->order = order;
+}
+
+static void __CTF_PLAN_FREE(__CTF_Run_Plan *plan)
+{
+    free(plan->order);
+    plan->order = NULL;
+}
+
+/* --list output, one "Suite/Test" line per selected test */
+__CTF_API void __CTF_LIST_TESTS(const __CTF_Test_Suite *suite)
+{
+    __CTF_Run_Plan plan;
+    __CTF_PLAN_SUITE(suite, &plan);
+    int i;
+    for (i = 0; i < plan.count; i++)
+    {
+        __CTF_PRINT("%s/%s\n", suite->name, suite->tests[__CTF_PLAN_AT(&plan, i)].test_name);
+    }
+    __CTF_PLAN_FREE(&plan);
+}
+
+/**
+ * @brief Starts pass number pass over the planned tests of a suite, shuffling their order when --shuffle is set.
+ *
+ * @return false once the suite is done, always after the first pass while a suite loop drives the passes.
+ */
+static bool __CTF_REPEAT_PASS(const __CTF_Test_Suite *suite, __CTF_Run_Plan *plan, unsigned long long pass)
+{
+    if (__ctf_repeat_outer ? pass > 0 : !__CTF_REPEAT_CONTINUE(pass))
+    {
+        if (!__ctf_repeat_outer)
+            __ctf_quiet = false;
+        return false;
+    }
+    if (!__ctf_repeat_outer)
+        __CTF_REPEAT_BEGIN(pass);
+    if (__ctf_shuffle && plan->order)
+        __CTF_SHUFFLE(plan->order, plan->count, __ctf_iteration, suite->name);
+    return true;
+}
+
+/*
+    Threaded tests.
+
+    The body of a CTF_TEST_THREADED test runs on threads of its own, one per index, while the thread running the
+    test only waits for them. On Linux each thread is pinned to the next CPU of the process's affinity mask, then
+    they all spin on a shared counter until the last one arrived, so the bodies start within a few hundred cycles of
+    each other and contend as hard as they can.
+
+    Each thread counts as a test of its own for asserts and crashes. CTF_ASSERT returns from the body on that thread
+    only, and a signal jumps back into that thread's frame. Either way the thread goes into the run's atomic failure
+    record, which also raises CTF_THREAD_STOPPED() for the others. Messages name the thread as "test#index".
+
+    The run is timed from the earliest start after the barrier to the latest finish, which gives the aggregate ops/s
+    from what every thread counted with CTF_THREAD_OPS. Without POSIX threads the indexes run one after another on
+    the test's own thread.
+*/
+
+#define __CTF_THREAD_SPINS_BEFORE_YIELD 4096
+
+/* The ops/s report is built here before going to __CTF_LOG, which has its own buffer */
+static __CTF_THREAD_LOCAL char __ctf_threaded_buffer[__CTF_LOG_BUFFER_SIZE];
+
+typedef struct
+{
+    const char *suite_name;
+    const char *test_name;
+    int (*body)(__CTF_Thread *);
+    int count;
+    __CTF_Thread *threads;
+#ifdef __CTF_POSIX
+    pthread_t *handles;
+    int started;
+    _Atomic int arrived;
+    _Atomic int stop;
+    /* The failure record, the first failing thread and the first signal are kept */
+    _Atomic int failures;
+    _Atomic int first_failure;
+    _Atomic int signal;
+#endif
+} __CTF_Threaded_Run;
+
+#ifdef __CTF_POSIX
+/* The run of the threaded test on this thread, left behind by __CTF_THREADED_ABANDON if the test is cut short */
+static __CTF_THREAD_LOCAL __CTF_Threaded_Run *__ctf_threaded_run = NULL;
+#endif
+
+static inline void __CTF_SPIN_PAUSE(void)
+{
+#if defined(__CTF_HAS_RDTSC)
+    _mm_pause();
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* Pins the calling thread to the index-th CPU it is allowed to run on, wrapping around */
+static __CTF_MAYBE_UNUSED void __CTF_THREAD_PIN(int index)
+{
+#if defined(__linux__) && defined(SYS_sched_getaffinity)
+    unsigned long mask[16], pinned[16];
+    int bits = (int)(sizeof(mask) * 8), cpus = 0, cpu;
+    memset(mask, 0, sizeof(mask));
+    if (syscall(SYS_sched_getaffinity, 0, sizeof(mask), mask) <= 0)
+        return;
+    for (cpu = 0; cpu < bits; cpu++)
+        cpus += (int)((mask[cpu / (8 * sizeof(long))] >> (cpu % (8 * sizeof(long)))) & 1);
+    if (cpus == 0)
+        return;
+    index %= cpus;
+    for (cpu = 0; cpu < bits; cpu++)
+    {
+        if (((mask[cpu / (8 * sizeof(long))] >> (cpu % (8 * sizeof(long)))) & 1) && index-- == 0)
+            break;
+    }
+    memset(pinned, 0, sizeof(pinned));
+    pinned[cpu / (8 * sizeof(long))] = 1ul << (cpu % (8 * sizeof(long)));
+    syscall(SYS_sched_setaffinity, 0, sizeof(pinned), pinned);
+#else
+    (void)index;
+#endif
+}
+
+__CTF_API __CTF_MAYBE_UNUSED bool __CTF_THREAD_STOPPED(const __CTF_Thread *thread)
+{
+#ifdef __CTF_POSIX
+    __CTF_Threaded_Run *run = (__CTF_Threaded_Run *)thread->run;
+    return run && atomic_load_explicit(&run->stop, memory_order_relaxed);
+#else
+    (void)thread;
+    return false;
+#endif
+}
+
+#ifdef __CTF_POSIX
+static void __CTF_THREAD_FAILED(__CTF_Threaded_Run *run, int index, int signal)
+{
+    int none = -1;
+    atomic_fetch_add(&run->failures, 1);
+    atomic_compare_exchange_strong(&run->first_failure, &none, index);
+    if (signal)
+    {
+        int no_signal = 0;
+        atomic_compare_exchange_strong(&run->signal, &no_signal, signal);
+    }
+    atomic_store(&run->stop, 1);
+}
+
+static void *__CTF_THREAD_MAIN(void *arg)
+{
+    __CTF_Thread *thread = (__CTF_Thread *)arg;
+    __CTF_Threaded_Run *run = (__CTF_Threaded_Run *)thread->run;
+    int spins = 0;
+    __ctf_current_test_suite_name = (char *)run->suite_name;
+    __ctf_current_test_name = thread->name;
+    __CTF_THREAD_PIN(thread->index);
+    __CTF_CRASH_STACK();
+    atomic_fetch_add(&run->arrived, 1);
+    while (atomic_load_explicit(&run->arrived, memory_order_acquire) < run->count)
+    {
+        /* More threads than CPUs would otherwise spin away the time slices of the ones still to arrive */
+        if (++spins % __CTF_THREAD_SPINS_BEFORE_YIELD == 0)
+            sched_yield();
+        __CTF_SPIN_PAUSE();
+    }
+    thread->start_ns = __CTF_NOW_NS();
+    if (__CTF_SETJMP(__ctf_env) == 0)
+    {
+        __signal_caught = 0;
+        __ctf_crash_recoverable = 1;
+        thread->status = run->body(thread);
+        __ctf_crash_recoverable = 0;
+        if (thread->status != __CTF_PASS_VALUE)
+            __CTF_THREAD_FAILED(run, thread->index, 0);
+    }
+    else
+    {
+        __ctf_crash_recoverable = 0;
+        thread->status = __CTF_FAIL_VALUE;
+        __CTF_CRASH_RECOVER();
+        __CTF_THREAD_FAILED(run, thread->index, __signal_caught);
+    }
+    thread->end_ns = __CTF_NOW_NS();
+    __ctf_current_test_name = NULL;
+    __CTF_ARENA_RELEASE();
+    __CTF_CRASH_RELEASE();
+    return NULL;
+}
+
+/* Lets the threads of a test that timed out or crashed run on detached, their run is leaked since they still use it */
+static void __CTF_THREADED_ABANDON(void)
+{
+    __CTF_Threaded_Run *run = __ctf_threaded_run;
+    int i;
+    if (!run)
+        return;
+    __ctf_threaded_run = NULL;
+    atomic_store(&run->stop, 1);
+    for (i = 0; i < run->started; i++)
+        pthread_detach(run->handles[i]);
+}
+#else
+static void __CTF_THREADED_ABANDON(void)
+{
+}
+#endif
+
+/* Logs ops/s of the whole run and of each thread, if the body counted any ops */
+static void __CTF_THREADED_REPORT(const __CTF_Threaded_Run *run)
+{
+    unsigned long long ops = 0, start = 0, end = 0;
+    int i;
+    for (i = 0; i < run->count; i++)
+    {
+        const __CTF_Thread *thread = &run->threads[i];
+        ops += thread->ops;
+        if (i == 0 || thread->start_ns < start)
+            start = thread->start_ns;
+        if (thread->end_ns > end)
+            end = thread->end_ns;
+    }
+    if (ops == 0 || __ctf_quiet)
+        return;
+    double seconds = end > start ? (double)(end - start) * 1e-9 : 1e-9;
+    size_t length = __CTF_LOG_FORMAT_ARGS(__ctf_threaded_buffer, 0, "\n\t%sThreaded %s\"%s\"%s: %d threads, %llu ops in %.6fs, %.4g ops/s%s",
+                                          __CTF_ANSI_BLUE, __CTF_ANSI_YELLOW, run->test_name, __CTF_ANSI_BLUE, run->count, ops, seconds,
+                                          (double)ops / seconds, __CTF_ANSI_RESET);
+    for (i = 0; i < run->count; i++)
+    {
+        const __CTF_Thread *thread = &run->threads[i];
+        double own = thread->end_ns > thread->start_ns ? (double)(thread->end_ns - thread->start_ns) * 1e-9 : 1e-9;
+        length = __CTF_LOG_FORMAT_ARGS(__ctf_threaded_buffer, length, "\n\t\tthread %d: %llu ops, %.4g ops/s", i, thread->ops, (double)thread->ops / own);
+    }
+    (void)length;
+    __CTF_LOG("%s", __ctf_threaded_buffer);
+}
+
+/**
+ * @brief Runs body on count threads at once, 0 meaning one per online CPU.
+ *
+ * @return __CTF_PASS_VALUE if every thread passed.
+ */
+__CTF_API __CTF_MAYBE_UNUSED int __CTF_THREADED_RUN(const char *test_name, int (*body)(__CTF_Thread *), int count)
+{
+    __CTF_Threaded_Run *run;
+    int i, status = __CTF_PASS_VALUE;
+#ifdef __CTF_POSIX
+    if (count <= 0)
+        count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (count <= 0)
+        count = 1;
+#ifdef __CTF_POSIX
+    /* Threads may outlive the test if it is cut short, so the run can't live on this stack */
+    __CTF_TIMEOUT_DEFER();
+    run = (__CTF_Threaded_Run *)calloc(1, sizeof(__CTF_Threaded_Run));
+    __CTF_Thread *threads = (__CTF_Thread *)calloc(count, sizeof(__CTF_Thread));
+    pthread_t *handles = (pthread_t *)calloc(count, sizeof(pthread_t));
+    if (!run || !threads || !handles)
+    {
+        free(run);
+        free(threads);
+        free(handles);
+        __CTF_LOG("%sOut of memory for %d threads of \"%s\".%s", __CTF_ANSI_RED, count, test_name, __CTF_ANSI_RESET);
+        __CTF_TIMEOUT_RESUME();
+        return __CTF_FAIL_VALUE;
+    }
+    run->handles = handles;
+    atomic_init(&run->arrived, 0);
+    atomic_init(&run->stop, 0);
+    atomic_init(&run->failures, 0);
+    atomic_init(&run->first_failure, -1);
+    atomic_init(&run->signal, 0);
+#else
+    __CTF_Threaded_Run local;
+    run = &local;
+    memset(run, 0, sizeof(*run));
+    __CTF_Thread *threads = (__CTF_Thread *)calloc(count, sizeof(__CTF_Thread));
+    if (!threads)
+        return __CTF_FAIL_VALUE;
+#endif
+    run->suite_name = __ctf_current_test_suite_name;
+    run->test_name = test_name;
+    run->body = body;
+    run->count = count;
+    run->threads = threads;
+    for (i = 0; i < count; i++)
+    {
+        threads[i].index = i;
+        threads[i].count = count;
+        threads[i].run = run;
+        snprintf(threads[i].name, sizeof(threads[i].name), "%s#%d", test_name, i);
+    }
+#ifdef __CTF_POSIX
+    __ctf_threaded_run = run;
+    for (i = 0; i < count; i++)
+    {
+        if (pthread_create(&handles[i], NULL, __CTF_THREAD_MAIN, &threads[i]) != 0)
+            break;
+        run->started++;
+    }
+    if (run->started < count)
+    {
+        /* Stand in for the threads that couldn't start so the others get past the barrier */
+        __CTF_LOG("%sCould only start %d of %d threads for \"%s\".%s", __CTF_ANSI_RED, run->started, count, test_name, __CTF_ANSI_RESET);
+        atomic_store(&run->stop, 1);
+        atomic_fetch_add(&run->arrived, count - run->started);
+        status = __CTF_FAIL_VALUE;
+    }
+    /* From here on __CTF_THREADED_ABANDON can clean up after a timeout */
+    __CTF_TIMEOUT_RESUME();
+    for (i = 0; i < run->started; i++)
+        pthread_join(handles[i], NULL);
+    __ctf_threaded_run = NULL;
+    int failures = atomic_load(&run->failures);
+    if (failures > 0)
+    {
+        __CTF_LOG("%s%d of %d threads of \"%s\" failed, thread %d first.%s", __CTF_ANSI_RED, failures, count, test_name,
+                  atomic_load(&run->first_failure), __CTF_ANSI_RESET);
+        /* Reported as the test's signal, like a crash on the test's own thread */
+        if (atomic_load(&run->signal))
+            __signal_caught = atomic_load(&run->signal);
+        status = __CTF_FAIL_VALUE;
+    }
+    if (run->started == count)
+        __CTF_THREADED_REPORT(run);
+    free(handles);
+    free(threads);
+    free(run);
+#else
+    for (i = 0; i < count; i++)
+    {
+        threads[i].start_ns = __CTF_NOW_NS();
+        threads[i].status = body(&threads[i]);
+        threads[i].end_ns = __CTF_NOW_NS();
+        if (threads[i].status != __CTF_PASS_VALUE)
+            status = __CTF_FAIL_VALUE;
+    }
+    __CTF_THREADED_REPORT(run);
+    free(threads);
+#endif
+    return status;
+}
+
+/*
+    Suite hooks and fixtures.
+
+    The setup hook of a suite runs once on the calling thread, right before the first of its selected tests, so a
+    suite that is filtered out or only listed never pays for it. The -j workers and the --isolate zygote start later
+    and see everything it built, tests may only read it. The teardown hook runs after the last test whenever the
+    setup ran, also when it failed halfway, so it must cope with partial state. Both end like a test and are
+    recovered from when they crash; when the setup fails, the suite's tests are reported as failed without running.
+
+    A CTF_FIXTURE belongs to the tests declared with CTF_TEST_FIXTURE instead. Its setup runs right before each of
+    them on that test's thread and its teardown right after, also when the test crashed or timed out.
+*/
+
+/* Fixture of the running test and what its setup returned, the runner tears it down after a crash or timeout */
+static __CTF_THREAD_LOCAL const __CTF_Fixture *__ctf_fixture = NULL;
+__CTF_API __CTF_THREAD_LOCAL __CTF_MAYBE_UNUSED void *__ctf_fixture_data = NULL;
+
+static void __CTF_FIXTURE_TEARDOWN(void)
+{
+    const __CTF_Fixture *fixture = __ctf_fixture;
+    if (!fixture)
+        return;
+    /* Cleared first, a teardown that crashes is not run a second time */
+    __ctf_fixture = NULL;
+    if (fixture->teardown)
+        fixture->teardown(__ctf_fixture_data);
+    __ctf_fixture_data = NULL;
+}
+
+__CTF_API __CTF_MAYBE_UNUSED int __CTF_FIXTURE_RUN(const __CTF_Fixture *fixture, int (*body)())
+{
+    __ctf_fixture_data = fixture->setup ? fixture->setup() : NULL;
+    __ctf_fixture = fixture;
+    int ret = body();
+    __CTF_FIXTURE_TEARDOWN();
+    return ret;
+}
+
+/**
+ * @brief Runs the test function once under the jump buffer and records how it went.
+ *
+ * @note The jump buffer and the signal flag are thread local, so every worker recovers into its own frame.
+ */
+static void __CTF_RUN_TEST_ONCE(const __CTF_Test *test, __CTF_Test_Result *result)
+{
+    __ctf_current_test_name = (char *)test->test_name;
+    double start = __CTF_NOW();
+    __ctf_test_start_ns = __CTF_NOW_NS();
+    __ctf_timed_out = 0;
+    __ctf_param_cases = 0;
+    __ctf_param_passed = 0;
+    __CTF_CRASH_STACK();
+    if (__CTF_SETJMP(__ctf_env) == 0)
+    {
+        __signal_caught = 0;
+        __ctf_crash_recoverable = 1;
+        if (__ctf_timeout_ms)
+            __CTF_WATCH_ARM(__ctf_timeout_ms);
+        __CTF_PERF_BEGIN();
+        __CTF_ALLOC_BEGIN();
+        int ret = test->test_func();
+        __ctf_crash_recoverable = 0;
+        __CTF_ALLOC_END();
+        __CTF_PERF_END(&result->perf);
+        __CTF_WATCH_DISARM();
+        result->status = ret == __CTF_PASS_VALUE && __signal_caught == 0 ? __CTF_TEST_PASSED : __CTF_TEST_FAILED;
+    }
+    else
+    {
+        __ctf_crash_recoverable = 0;
+        __CTF_ALLOC_END();
+        __CTF_PERF_END(&result->perf);
+        __CTF_WATCH_DISARM();
+        if (__ctf_timed_out)
+        {
+            result->status = __CTF_TEST_TIMED_OUT;
+        }
+        else
+        {
+            result->status = __CTF_TEST_SIGNALED;
+            __CTF_CRASH_RECOVER();
+        }
+        __CTF_THREADED_ABANDON();
+        __CTF_FIXTURE_TEARDOWN();
+    }
+    __CTF_ARENA_RESET();
+    if (__ctf_trace)
+        __CTF_TRACE_COMPLETE(test->test_name, "test", __ctf_test_start_ns, __CTF_NOW_NS());
+    result->signal = __signal_caught;
+    result->elapsed = __CTF_NOW() - start;
+    result->alloc = __ctf_alloc_stats;
+    result->cases = __ctf_param_cases;
+    result->cases_passed = __ctf_param_passed;
+    result->case_index = -1;
+}
+
+/* Collects --samples timings of a passing test, or the samples of a benchmark, returns 0 if the test is flaky */
+static int __CTF_BASELINE_MEASURE(const __CTF_Test *test, const __CTF_Test_Result *result, double *samples, int count)
+{
+    if (count == 0)
+    {
+        int runs = __ctf_baseline_samples < 1 ? 1 : __ctf_baseline_samples > __CTF_MAX_SAMPLES ? __CTF_MAX_SAMPLES : __ctf_baseline_samples;
+        samples[count++] = result->elapsed;
+        while (count < runs)
+        {
+            __CTF_Test_Result rerun;
+            __CTF_RUN_TEST_ONCE(test, &rerun);
+            /* A flaky test has no meaningful timing */
+            if (rerun.status != __CTF_TEST_PASSED)
+                return 0;
+            samples[count++] = rerun.elapsed;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Runs a single test on the calling thread and collects its baseline samples without recording them.
+ *
+ * @return The number of samples, 0 without a baseline or if the test didn't pass.
+ */
+static int __CTF_RUN_TEST_SAMPLED(const __CTF_Test *test, __CTF_Test_Result *result, double *samples)
+{
+    result->baseline = __CTF_BASELINE_NONE;
+    result->baseline_change = 0;
+    result->baseline_p = 1;
+    if (!__CTF_BASELINE_ACTIVE())
+    {
+        __CTF_RUN_TEST_ONCE(test, result);
+        return 0;
+    }
+    __ctf_sample_sink = samples;
+    __ctf_sample_sink_count = 0;
+    __CTF_RUN_TEST_ONCE(test, result);
+    __ctf_sample_sink = NULL;
+    if (result->status != __CTF_TEST_PASSED)
+        return 0;
+    return __CTF_BASELINE_MEASURE(test, result, samples, __ctf_sample_sink_count);
+}
+
+/**
+ * @brief Runs a single test on the calling thread and records how it went.
+ *
+ * @note The jump buffer and the signal flag are thread local, so every worker recovers into its own frame.
+ */
+static void __CTF_RUN_TEST(const __CTF_Test *test, __CTF_Test_Result *result)
+{
+    double samples[__CTF_MAX_SAMPLES];
+    int count = __CTF_RUN_TEST_SAMPLED(test, result, samples);
+    if (count > 0)
+        __CTF_BASELINE_RECORD(test, samples, count, result);
+}
+
+static void __CTF_SUMMARY_ADD(__CTF_Suite_Summary *summary, const __CTF_Test_Result *result)
+{
+    if (result->cases > 0)
+    {
+        /* Every case counts as a test, a timeout stops the remaining ones */
+        summary->total += (int)result->cases;
+        summary->passed += (int)result->cases_passed;
+        if (result->status == __CTF_TEST_TIMED_OUT)
+            summary->timed_out++;
+    }
+    else
+    {
+        summary->total++;
+        if (result->status == __CTF_TEST_PASSED)
+            summary->passed++;
+        else if (result->status == __CTF_TEST_TIMED_OUT)
+            summary->timed_out++;
+    }
+    if (result->baseline == __CTF_BASELINE_REGRESSED)
+    {
+        summary->regressed++;
+        __ctf_baseline_regressions++;
+    }
+}
+
+static void __CTF_PERF_FORMAT(const __CTF_Perf_Stats *perf, char *buffer, size_t size)
+{
+    int written = 0;
+    if (perf->hardware)
+    {
+        written = snprintf(buffer, size, "\t%sCycles: %llu, instructions: %llu (IPC %.2f), cache misses: %llu, branch misses: %llu%s\n",
+                           __CTF_ANSI_YELLOW, perf->cycles, perf->instructions, perf->cycles ? (double)perf->instructions / (double)perf->cycles : 0.0,
+                           perf->cache_misses, perf->branch_misses, __CTF_ANSI_RESET);
+        if (written < 0 || (size_t)written >= size)
+            return;
+    }
+    snprintf(buffer + written, size - written, "\t%sPage faults: %llu, context switches: %llu, peak RSS: %llu KiB%s%s\n", __CTF_ANSI_YELLOW,
+             perf->page_faults, perf->context_switches, perf->peak_rss_kb, perf->hardware ? "" : " (hardware counters unavailable)", __CTF_ANSI_RESET);
+}
+
+static void __CTF_PRINT_TEST_RESULT(const char *test_name, const __CTF_Test_Result *result)
+{
+    /* One message per test so lines from different workers never interleave */
+    char allocs[512] = "";
+#ifdef __CTF_ALLOC_TRACKING
+    snprintf(allocs, sizeof(allocs), "\t%sAllocations: %llu (%llu bytes, peak %lld bytes, leaked %llu bytes)%s\n", __CTF_ANSI_YELLOW,
+             result->alloc.count, result->alloc.bytes, result->alloc.peak, __CTF_ALLOC_LEAKED(&result->alloc), __CTF_ANSI_RESET);
+#endif
+    if (__ctf_perf)
+        __CTF_PERF_FORMAT(&result->perf, allocs + strlen(allocs), sizeof(allocs) - strlen(allocs));
+    if (result->baseline >= __CTF_BASELINE_UNCHANGED)
+        snprintf(allocs + strlen(allocs), sizeof(allocs) - strlen(allocs), "\t%sBaseline: %s, median %+.2f%% (p = %.4f)%s\n",
+                 result->baseline == __CTF_BASELINE_REGRESSED ? __CTF_ANSI_RED : result->baseline == __CTF_BASELINE_IMPROVED ? __CTF_ANSI_GREEN : __CTF_ANSI_YELLOW,
+                 __CTF_BASELINE_NAME(result->baseline), result->baseline_change, result->baseline_p, __CTF_ANSI_RESET);
+    else if (result->baseline == __CTF_BASELINE_NEW)
+        snprintf(allocs + strlen(allocs), sizeof(allocs) - strlen(allocs), "\t%sBaseline: new test%s\n", __CTF_ANSI_YELLOW, __CTF_ANSI_RESET);
+    if (result->cases > 0)
+        snprintf(allocs + strlen(allocs), sizeof(allocs) - strlen(allocs), "\t%sCases: %ld of %ld passed%s\n",
+                 result->cases_passed == result->cases ? __CTF_ANSI_GREEN : __CTF_ANSI_RED, result->cases_passed, result->cases, __CTF_ANSI_RESET);
+    if (result->status == __CTF_TEST_PASSED)
+    {
+        __CTF_PRINT("%sTest %s\"%s\"%s passed.%s\n\t%sElapsed time: %fs%s\n%s", __CTF_ANSI_GREEN, __CTF_ANSI_YELLOW, test_name, __CTF_ANSI_GREEN, __CTF_ANSI_RESET,
+                    __CTF_ANSI_YELLOW, result->elapsed, __CTF_ANSI_RESET, allocs);
+    }
+    else if (result->status == __CTF_TEST_TIMED_OUT)
+    {
+        __CTF_PRINT("%sTest %s\"%s\"%s timed out.%s\n\t%sElapsed time: %fs%s\n%s", __CTF_ANSI_RED, __CTF_ANSI_YELLOW, test_name, __CTF_ANSI_RED, __CTF_ANSI_RESET,
+                    __CTF_ANSI_YELLOW, result->elapsed, __CTF_ANSI_RESET, allocs);
+    }
+    else if (result->status == __CTF_TEST_SIGNALED)
+    {
+        __CTF_PRINT("%sTest %s\"%s\"%s failed due to signal %d.%s\n\t%sElapsed time: %fs%s\n%s", __CTF_ANSI_RED, __CTF_ANSI_YELLOW, test_name, __CTF_ANSI_RED, result->signal, __CTF_ANSI_RESET,
+                    __CTF_ANSI_YELLOW, result->elapsed, __CTF_ANSI_RESET, allocs);
+    }
+    else
+    {
+        __CTF_PRINT("%sTest \"%s\" failed.\n%s\t%sElapsed time: %fs%s\n%s", __CTF_ANSI_RED, test_name, __CTF_ANSI_RESET,
+                    __CTF_ANSI_YELLOW, result->elapsed, __CTF_ANSI_RESET, allocs);
+    }
+}
+
+static void __CTF_PRINT_SUITE_SUMMARY(const char *name, const __CTF_Suite_Summary *summary)
+{
+    char timed_out[128] = "";
+    if (summary->timed_out)
+        snprintf(timed_out, sizeof timed_out, "\n%sTimed out tests: %d", __CTF_ANSI_RED, summary->timed_out);
+    if (summary->regressed)
+        snprintf(timed_out + strlen(timed_out), sizeof timed_out - strlen(timed_out), "\n%sRegressed tests: %d", __CTF_ANSI_RED, summary->regressed);
+    __CTF_LOG("\nTest suite %s\"%s\"%s summary:\n%sTotal tests: %d\n%sPassed tests: %d\n%sFailed tests: %d%s\n%sPass rate: %.2f%%%s",
+              __CTF_ANSI_YELLOW, name, __CTF_ANSI_RESET,
+              __CTF_ANSI_BLUE, summary->total,
+              __CTF_ANSI_GREEN, summary->passed,
+              __CTF_ANSI_RED, summary->total - summary->passed - summary->timed_out, timed_out,
+              __CTF_ANSI_YELLOW, summary->total ? (float)summary->passed / summary->total * 100 : 0.0f, __CTF_ANSI_RESET);
+}
+
+/*
+    Reporters.
+
+    Every result goes through the active reporters: the console reporter (the colored output above) and at most one
+    machine readable one picked with --reporter, plus any added with CTF_REPORTER_ADD. Events are emitted as they
+    happen, from the worker that ran the test when -j is used, so reporters must be thread safe. The built in
+    machine reporters write through stdio under a lock and flush at the end of every suite.
+*/
+
+#define __CTF_MAX_REPORTERS 8
+
+static const __CTF_Reporter *__ctf_reporters[__CTF_MAX_REPORTERS];
+static int __ctf_reporter_count = 0;
+static bool __ctf_reporters_ready = false;
+
+/* Set with --reporter and --report-file */
+static const char *__ctf_reporter_name = NULL;
+static const char *__ctf_report_file_name = NULL;
+static FILE *__ctf_report_file = NULL;
+
+#ifdef __CTF_POSIX
+static pthread_mutex_t __ctf_report_lock = PTHREAD_MUTEX_INITIALIZER;
+#define __CTF_REPORT_LOCK() pthread_mutex_lock(&__ctf_report_lock)
+#define __CTF_REPORT_UNLOCK() pthread_mutex_unlock(&__ctf_report_lock)
+#else
+#define __CTF_REPORT_LOCK()
+#define __CTF_REPORT_UNLOCK()
+#endif
+
+static const char *__CTF_STATUS_NAME(int status)
+{
+    switch (status)
+    {
+    case __CTF_TEST_PASSED:
+        return "passed";
+    case __CTF_TEST_SIGNALED:
+        return "signaled";
+    case __CTF_TEST_TIMED_OUT:
+        return "timed_out";
+    default:
+        return "failed";
+    }
+}
+
+/* Writes text escaped for a JSON string or, when json is false, an XML attribute */
+static void __CTF_REPORT_ESCAPED(FILE *file, const char *text, bool json)
+{
+    for (; *text; text++)
+    {
+        unsigned char c = (unsigned char)*text;
+        if (json && (c == '"' || c == '\\'))
+            fprintf(file, "\\%c", c);
+        else if (json && c < 0x20)
+            fprintf(file, "\\u%04x", c);
+        else if (!json && c == '<')
+            fputs("&lt;", file);
+        else if (!json && c == '>')
+            fputs("&gt;", file);
+        else if (!json && c == '&')
+            fputs("&amp;", file);
+        else if (!json && c == '"')
+            fputs("&quot;", file);
+        else
+            fputc(c, file);
+    }
+}
+
+/* Console */
+
+static void __CTF_CONSOLE_SUITE_START(const char *suite)
+{
+    if (__ctf_quiet)
+        return;
+    __CTF_PRINT("%s%sRunning Test Suite: %s\n%s", __CTF_ANSI_UNDERLINE, __CTF_ANSI_YELLOW, suite, __CTF_ANSI_RESET);
+}
+
+static void __CTF_CONSOLE_TEST_START(const char *suite, const char *test)
+{
+    (void)suite;
+    /* With several workers the start banners would only add noise between the results */
+    if (__ctf_jobs <= 1 && !__ctf_quiet)
+        __CTF_PRINT("%sRunning Test: %s%s%s...\n%s", __CTF_ANSI_BLUE, __CTF_ANSI_YELLOW, test, __CTF_ANSI_BLUE, __CTF_ANSI_RESET);
+}
+
+static void __CTF_CONSOLE_TEST_END(const char *suite, const char *test, const __CTF_Test_Result *result)
+{
+    (void)suite;
+    /* Passing cases of a parametrized test are only counted, the test prints one line for all of them */
+    if (result->case_index >= 0 && result->status == __CTF_TEST_PASSED)
+        return;
+    /* Repeated passes only show what failed */
+    if (__ctf_quiet && result->status == __CTF_TEST_PASSED)
+        return;
+    __CTF_PRINT_TEST_RESULT(test, result);
+}
+
+static void __CTF_CONSOLE_SUITE_END(const char *suite, const __CTF_Suite_Summary *summary, double elapsed)
+{
+    (void)elapsed;
+    if (!__ctf_quiet)
+        __CTF_PRINT_SUITE_SUMMARY(suite, summary);
+}
+
+static const __CTF_Reporter __ctf_console_reporter = {
+    __CTF_CONSOLE_SUITE_START,
+    __CTF_CONSOLE_TEST_START,
+    __CTF_CONSOLE_TEST_END,
+    __CTF_CONSOLE_SUITE_END,
+    NULL,
+};
+
+/* JSON Lines, one object per event */
+
+static void __CTF_JSON_SUITE_START(const char *suite)
+{
+    __CTF_REPORT_LOCK();
+    fputs("{\"event\":\"suite_start\",\"suite\":\"", __ctf_report_file);
+    __CTF_REPORT_ESCAPED(__ctf_report_file, suite, true);
+    fputs("\"}\n", __ctf_report_file);
+    __CTF_REPORT_UNLOCK();
+}
+
+static void __CTF_JSON_TEST_END(const char *suite, const char *test, const __CTF_Test_Result *result)
+{
+    /* The cases of a parametrized test were reported one by one already */
+    if (result->cases > 0)
+        return;
+    __CTF_REPORT_LOCK();
+    fputs("{\"event\":\"test_end\",\"suite\":\"", __ctf_report_file);
+    __CTF_REPORT_ESCAPED(__ctf_report_file, suite, true);
+    fputs("\",\"test\":\"", __ctf_report_file);
+    __CTF_REPORT_ESCAPED(__ctf_report_file, test, true);
+    fprintf(__ctf_report_file, "\",\"status\":\"%s\",\"duration\":%.9f,\"signal\":%d",
+            __CTF_STATUS_NAME(result->status), result->elapsed, result->signal);
+#ifdef __CTF_ALLOC_TRACKING
+    fprintf(__ctf_report_file, ",\"allocs\":%llu,\"alloc_bytes\":%llu,\"peak_bytes\":%lld,\"leaked_bytes\":%llu",
+            result->alloc.count, result->alloc.bytes, result->alloc.peak, __CTF_ALLOC_LEAKED(&result->alloc));
+#endif
+    if (__ctf_perf)
+    {
+        const __CTF_Perf_Stats *perf = &result->perf;
+        if (perf->hardware)
+            fprintf(__ctf_report_file, ",\"cycles\":%llu,\"instructions\":%llu,\"ipc\":%.4f,\"cache_misses\":%llu,\"branch_misses\":%llu",
+                    perf->cycles, perf->instructions, perf->cycles ? (double)perf->instructions / (double)perf->cycles : 0.0,
+                    perf->cache_misses, perf->branch_misses);
+        fprintf(__ctf_report_file, ",\"page_faults\":%llu,\"context_switches\":%llu,\"peak_rss_kb\":%llu",
+                perf->page_faults, perf->context_switches, perf->peak_rss_kb);
+    }
+    if (result->baseline != __CTF_BASELINE_NONE)
+        fprintf(__ctf_report_file, ",\"baseline\":\"%s\",\"baseline_change\":%.4f,\"baseline_p\":%.6f",
+                __CTF_BASELINE_NAME(result->baseline), result->baseline_change, result->baseline_p);
+    fputs("}\n", __ctf_report_file);
+    __CTF_REPORT_UNLOCK();
+}
+
+static void __CTF_JSON_SUITE_END(const char *suite, const __CTF_Suite_Summary *summary, double elapsed)
+{
+    __CTF_REPORT_LOCK();
+    fputs("{\"event\":\"suite_end\",\"suite\":\"", __ctf_report_file);
+    __CTF_REPORT_ESCAPED(__ctf_report_file, suite, true);
+    fprintf(__ctf_report_file, "\",\"total\":%d,\"passed\":%d,\"failed\":%d,\"timed_out\":%d,\"regressed\":%d,\"duration\":%.9f}\n",
+            summary->total, summary->passed, summary->total - summary->passed - summary->timed_out, summary->timed_out, summary->regressed, elapsed);
+    fflush(__ctf_report_file);
+    __CTF_REPORT_UNLOCK();
+}
+
+static void __CTF_JSON_PROCESS_EXIT(unsigned int suites_ran, double elapsed)
+{
+    fprintf(__ctf_report_file, "{\"event\":\"exit\",\"suites\":%u,\"duration\":%.9f}\n", suites_ran, elapsed);
+}
+
+static const __CTF_Reporter __ctf_json_reporter = {
+    __CTF_JSON_SUITE_START,
+    NULL,
+    __CTF_JSON_TEST_END,
+    __CTF_JSON_SUITE_END,
+    __CTF_JSON_PROCESS_EXIT,
+};
+
+/* JUnit XML, testsuite elements are opened and closed as suites run so nothing is held back */
+
+static bool __ctf_junit_open = false;
+
+static void __CTF_JUNIT_SUITE_START(const char *suite)
+{
+    __CTF_REPORT_LOCK();
+    if (!__ctf_junit_open)
+    {
+        fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n", __ctf_report_file);
+        __ctf_junit_open = true;
+    }
+    fputs("  <testsuite name=\"", __ctf_report_file);
+    __CTF_REPORT_ESCAPED(__ctf_report_file, suite, false);
+    fputs("\">\n", __ctf_report_file);
+    __CTF_REPORT_UNLOCK();
+}
+
+static void __CTF_JUNIT_TEST_END(const char *suite, const char *test, const __CTF_Test_Result *result)
+{
+    if (result->cases > 0)
+        return;
+    __CTF_REPORT_LOCK();
+    fputs("    <testcase classname=\"", __ctf_report_file);
+    __CTF_REPORT_ESCAPED(__ctf_report_file, suite, false);
+    fputs("\" name=\"", __ctf_report_file);
+    __CTF_REPORT_ESCAPED(__ctf_report_file, test, false);
+    fprintf(__ctf_report_file, "\" time=\"%.6f\">\n", result->elapsed);
+#ifdef __CTF_ALLOC_TRACKING
+    bool properties = true;
+#else
+    bool properties = __ctf_perf || result->baseline != __CTF_BASELINE_NONE;
+#endif
+    if (properties)
+        fputs("      <properties>\n", __ctf_report_file);
+#ifdef __CTF_ALLOC_TRACKING
+    fprintf(__ctf_report_file,
+            "        <property name=\"allocs\" value=\"%llu\"/>\n"
+            "        <property name=\"alloc_bytes\" value=\"%llu\"/>\n"
+            "        <property name=\"peak_bytes\" value=\"%lld\"/>\n"
+            "        <property name=\"leaked_bytes\" value=\"%llu\"/>\n",
+            result->alloc.count, result->alloc.bytes, result->alloc.peak, __CTF_ALLOC_LEAKED(&result->alloc));
+#endif
+    if (__ctf_perf)
+    {
+        const __CTF_Perf_Stats *perf = &result->perf;
+        if (perf->hardware)
+            fprintf(__ctf_report_file,
+                    "        <property name=\"cycles\" value=\"%llu\"/>\n"
+                    "        <property name=\"instructions\" value=\"%llu\"/>\n"
+                    "        <property name=\"cache_misses\" value=\"%llu\"/>\n"
+                    "        <property name=\"branch_misses\" value=\"%llu\"/>\n",
+                    perf->cycles, perf->instructions, perf->cache_misses, perf->branch_misses);
+        fprintf(__ctf_report_file,
+                "        <property name=\"page_faults\" value=\"%llu\"/>\n"
+                "        <property name=\"context_switches\" value=\"%llu\"/>\n"
+                "        <property name=\"peak_rss_kb\" value=\"%llu\"/>\n",
+                perf->page_faults, perf->context_switches, perf->peak_rss_kb);
+    }
+    if (result->baseline != __CTF_BASELINE_NONE)
+        fprintf(__ctf_report_file,
+                "        <property name=\"baseline\" value=\"%s\"/>\n"
+                "        <property name=\"baseline_change\" value=\"%.4f\"/>\n"
+                "        <property name=\"baseline_p\" value=\"%.6f\"/>\n",
+                __CTF_BASELINE_NAME(result->baseline), result->baseline_change, result->baseline_p);
+    if (properties)
+        fputs("      </properties>\n", __ctf_report_file);
+    if (result->status == __CTF_TEST_SIGNALED)
+        fprintf(__ctf_report_file, "      <error type=\"signal\" message=\"Caught signal %d\"/>\n", result->signal);
+    else if (result->status == __CTF_TEST_TIMED_OUT)
+        fputs("      <failure type=\"timeout\" message=\"Timed out\"/>\n", __ctf_report_file);
+    else if (result->status != __CTF_TEST_PASSED)
+        fputs("      <failure type=\"assertion\" message=\"Failed\"/>\n", __ctf_report_file);
+    fputs("    </testcase>\n", __ctf_report_file);
+    __CTF_REPORT_UNLOCK();
+}
+
+static void __CTF_JUNIT_SUITE_END(const char *suite, const __CTF_Suite_Summary *summary, double elapsed)
+{
+    (void)suite;
+    (void)summary;
+    (void)elapsed;
+    __CTF_REPORT_LOCK();
+    fputs("  </testsuite>\n", __ctf_report_file);
+    fflush(__ctf_report_file);
+    __CTF_REPORT_UNLOCK();
+}
+
+static void __CTF_JUNIT_PROCESS_EXIT(unsigned int suites_ran, double elapsed)
+{
+    (void)suites_ran;
+    (void)elapsed;
+    if (!__ctf_junit_open)
+        fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n", __ctf_report_file);
+    fputs("</testsuites>\n", __ctf_report_file);
+}
+
+static const __CTF_Reporter __ctf_junit_reporter = {
+    __CTF_JUNIT_SUITE_START,
+    NULL,
+    __CTF_JUNIT_TEST_END,
+    __CTF_JUNIT_SUITE_END,
+    __CTF_JUNIT_PROCESS_EXIT,
+};
+
+/* TAP version 13, the plan goes at the end since the number of tests is only known then */
+
+static unsigned int __ctf_tap_count = 0;
+/* Suites without tests don't count any, so the count can't tell whether the header was written */
+static bool __ctf_tap_started = false;
+
+static void __CTF_TAP_HEADER(void)
+{
+    if (__ctf_tap_started)
+        return;
+    __ctf_tap_started = true;
+    fputs("TAP version 13\n", __ctf_report_file);
+}
+
+static void __CTF_TAP_SUITE_START(const char *suite)
+{
+    __CTF_REPORT_LOCK();
+    __CTF_TAP_HEADER();
+    fprintf(__ctf_report_file, "# Suite %s\n", suite);
+    __CTF_REPORT_UNLOCK();
+}
+
+static void __CTF_TAP_TEST_END(const char *suite, const char *test, const __CTF_Test_Result *result)
+{
+    if (result->cases > 0)
+        return;
+    __CTF_REPORT_LOCK();
+    __ctf_tap_count++;
+    fprintf(__ctf_report_file, "%s %u - %s/%s\n", result->status == __CTF_TEST_PASSED ? "ok" : "not ok", __ctf_tap_count, suite, test);
+    if (result->status != __CTF_TEST_PASSED)
+        fprintf(__ctf_report_file, "  ---\n  status: %s\n  signal: %d\n  duration: %.6f\n  ...\n",
+                __CTF_STATUS_NAME(result->status), result->signal, result->elapsed);
+#ifdef __CTF_ALLOC_TRACKING
+    fprintf(__ctf_report_file, "# allocs %llu, %llu bytes, peak %lld bytes, leaked %llu bytes\n",
+            result->alloc.count, result->alloc.bytes, result->alloc.peak, __CTF_ALLOC_LEAKED(&result->alloc));
+#endif
+    if (__ctf_perf)
+    {
+        const __CTF_Perf_Stats *perf = &result->perf;
+        if (perf->hardware)
+            fprintf(__ctf_report_file, "# cycles %llu, instructions %llu, cache misses %llu, branch misses %llu\n",
+                    perf->cycles, perf->instructions, perf->cache_misses, perf->branch_misses);
+        fprintf(__ctf_report_file, "# page faults %llu, context switches %llu, peak RSS %llu KiB\n",
+                perf->page_faults, perf->context_switches, perf->peak_rss_kb);
+    }
+    if (result->baseline != __CTF_BASELINE_NONE)
+        fprintf(__ctf_report_file, "# baseline %s, median %+.2f%%, p %.4f\n",
+                __CTF_BASELINE_NAME(result->baseline), result->baseline_change, result->baseline_p);
+    __CTF_REPORT_UNLOCK();
+}
+
+static void __CTF_TAP_SUITE_END(const char *suite, const __CTF_Suite_Summary *summary, double elapsed)
+{
+    (void)suite;
+    (void)summary;
+    (void)elapsed;
+    fflush(__ctf_report_file);
+}
+
+static void __CTF_TAP_PROCESS_EXIT(unsigned int suites_ran, double elapsed)
+{
+    (void)suites_ran;
+    (void)elapsed;
+    __CTF_TAP_HEADER();
+    fprintf(__ctf_report_file, "1..%u\n", __ctf_tap_count);
+}
+
+static const __CTF_Reporter __ctf_tap_reporter = {
+    __CTF_TAP_SUITE_START,
+    NULL,
+    __CTF_TAP_TEST_END,
+    __CTF_TAP_SUITE_END,
+    __CTF_TAP_PROCESS_EXIT,
+};
+
+/**
+ * @brief Adds a reporter that receives every event, e.g. to feed results somewhere else. The struct must outlive the run.
+ *
+ */
+__CTF_API __CTF_MAYBE_UNUSED void __CTF_REPORTER_ADD(const __CTF_Reporter *reporter)
+{
+    if (__ctf_reporter_count < __CTF_MAX_REPORTERS)
+        __ctf_reporters[__ctf_reporter_count++] = reporter;
+}
+
+/* Sets up the console and --reporter reporters on first use */
+static void __CTF_REPORTERS_INIT(void)
+{
+    if (__ctf_reporters_ready)
+        return;
+    __ctf_reporters_ready = true;
+    const __CTF_Reporter *machine = NULL;
+    if (__ctf_reporter_name)
+    {
+        if (strcmp(__ctf_reporter_name, "json") == 0 || strcmp(__ctf_reporter_name, "jsonl") == 0)
+            machine = &__ctf_json_reporter;
+        else if (strcmp(__ctf_reporter_name, "junit") == 0 || strcmp(__ctf_reporter_name, "xml") == 0)
+            machine = &__ctf_junit_reporter;
+        else if (strcmp(__ctf_reporter_name, "tap") == 0)
+            machine = &__ctf_tap_reporter;
+        else if (strcmp(__ctf_reporter_name, "console") != 0)
+            __CTF_LOG("%sUnknown reporter \"%s\", using the console.%s", __CTF_ANSI_RED, __ctf_reporter_name, __CTF_ANSI_RESET);
+    }
+    if (machine && __ctf_report_file_name)
+    {
+        __ctf_report_file = fopen(__ctf_report_file_name, "w");
+        if (!__ctf_report_file)
+        {
+            __CTF_LOG("%sCould not open report file \"%s\".%s", __CTF_ANSI_RED, __ctf_report_file_name, __CTF_ANSI_RESET);
+            machine = NULL;
+        }
+    }
+    else if (machine)
+    {
+        /* The report owns stdout, console output only goes to the log file */
+        __ctf_report_file = stdout;
+        __ctf_log_console = false;
+    }
+    if (__ctf_log_console)
+        __CTF_REPORTER_ADD(&__ctf_console_reporter);
+    if (machine)
+        __CTF_REPORTER_ADD(machine);
+}
+
+#define __CTF_REPORT(event, ...)                                                                \
+    do                                                                                          \
+    {                                                                                           \
+        int __ctf_reporter_i;                                                                   \
+        __CTF_REPORTERS_INIT();                                                                 \
+        for (__ctf_reporter_i = 0; __ctf_reporter_i < __ctf_reporter_count; __ctf_reporter_i++) \
+        {                                                                                       \
+            if (__ctf_reporters[__ctf_reporter_i]->event)                                       \
+                __ctf_reporters[__ctf_reporter_i]->event(__VA_ARGS__);                          \
+        }                                                                                       \
+    } while (0)
+
+static void __CTF_REPORT_PROCESS_EXIT(unsigned int suites_ran, double elapsed)
+{
+    if (__ctf_list_only)
+        return;
+    __CTF_REPORT(process_exit, suites_ran, elapsed);
+    if (__ctf_report_file)
+    {
+        fflush(__ctf_report_file);
+        if (__ctf_report_file != stdout)
+            fclose(__ctf_report_file);
+        __ctf_report_file = NULL;
+    }
+}
+
+#ifdef __CTF_POSIX
+/*
+    Each worker owns a contiguous slice of the suite's tests packed as (tail << 32 | head).
+    The owner pops from the head and idle workers steal from the tail, both with a single CAS on the pair.
+*/
+typedef struct
+{
+    _Atomic unsigned long long range;
+} __CTF_Work_Queue;
+
+typedef struct
+{
+    const __CTF_Test_Suite *suite;
+    const __CTF_Run_Plan *plan;
+    /* Plan position of every queue slot, NULL when slots are positions */
+    const int *positions;
+    __CTF_Test_Result *results;
+    __CTF_Work_Queue *queues;
+    int workers;
+    int id;
+} __CTF_Worker;
+
+static int __CTF_WORK_POP(__CTF_Work_Queue *queue)
+{
+    unsigned long long range = atomic_load(&queue->range);
+    for (;;)
+    {
+        unsigned int head = (unsigned int)range, tail = (unsigned int)(range >> 32);
+        if (head >= tail)
+            return -1;
+        unsigned long long next = ((unsigned long long)tail << 32) | (head + 1);
+        if (atomic_compare_exchange_weak(&queue->range, &range, next))
+            return (int)head;
+    }
+}
+
+static int __CTF_WORK_STEAL(__CTF_Work_Queue *queue)
+{
+    unsigned long long range = atomic_load(&queue->range);
+    for (;;)
+    {
+        unsigned int head = (unsigned int)range, tail = (unsigned int)(range >> 32);
+        if (head >= tail)
+            return -1;
+        unsigned long long next = ((unsigned long long)(tail - 1) << 32) | head;
+        if (atomic_compare_exchange_weak(&queue->range, &range, next))
+            return (int)(tail - 1);
+    }
+}
+
+static void *__CTF_WORKER_MAIN(void *arg)
+{
+    __CTF_Worker *worker = (__CTF_Worker *)arg;
+    __ctf_current_test_suite_name = (char *)worker->suite->name;
+    for (;;)
+    {
+        int index = __CTF_WORK_POP(&worker->queues[worker->id]);
+        int victim;
+        for (victim = 1; index < 0 && victim < worker->workers; victim++)
+        {
+            index = __CTF_WORK_STEAL(&worker->queues[(worker->id + victim) % worker->workers]);
+        }
+        /* Nothing is ever pushed after the start, so empty queues everywhere means we are done */
+        if (index < 0)
+            break;
+        int position = worker->positions ? worker->positions[index] : index;
+        const __CTF_Test *test = &worker->suite->tests[__CTF_PLAN_AT(worker->plan, position)];
+        __CTF_REPORT(test_start, worker->suite->name, test->test_name);
+        __CTF_RUN_TEST(test, &worker->results[position]);
+        __CTF_REPORT(test_end, worker->suite->name, test->test_name, &worker->results[position]);
+    }
+    __ctf_current_test_name = NULL;
+    if (worker->id != 0)
+    {
+        __CTF_WATCH_RELEASE();
+        __CTF_PERF_RELEASE();
+        __CTF_ARENA_RELEASE();
+        __CTF_CRASH_RELEASE();
+    }
+    return NULL;
+}
+#endif
+
+/**
+ * @brief Spreads the tests of a suite over __ctf_jobs workers, the calling thread being worker 0.
+ *
+ * @return false if the suite should be run sequentially instead (-j 1, a single test, no threads or out of memory).
+ */
+static bool __CTF_RUN_TESTS_PARALLEL(const __CTF_Test_Suite *suite, const __CTF_Run_Plan *plan, __CTF_Suite_Summary *summary)
+{
+#ifdef __CTF_POSIX
+    int workers = __ctf_jobs < plan->count ? __ctf_jobs : plan->count;
+    if (workers <= 1)
+        return false;
+    __CTF_Test_Result *results = (__CTF_Test_Result *)calloc(plan->count, sizeof(__CTF_Test_Result));
+    __CTF_Work_Queue *queues = (__CTF_Work_Queue *)calloc(workers, sizeof(__CTF_Work_Queue));
+    __CTF_Worker *ctx = (__CTF_Worker *)calloc(workers, sizeof(__CTF_Worker));
+    pthread_t *threads = (pthread_t *)calloc(workers, sizeof(pthread_t));
+    bool *started = (bool *)calloc(workers, sizeof(bool));
+    if (!results || !queues || !ctx || !threads || !started)
+    {
+        free(results);
+        free(queues);
+        free(ctx);
+        free(threads);
+        free(started);
+        return false;
+    }
+    int i;
+    /* A longest first plan is dealt round robin over the slices, so each worker's head is one of the longest tests */
+    int *positions = plan->longest_first ? (int *)malloc(plan->count * sizeof(int)) : NULL;
+    if (positions)
+    {
+        int *filled = (int *)calloc(workers, sizeof(int));
+        int worker = 0;
+        if (!filled)
+        {
+            free(positions);
+            positions = NULL;
+        }
+        for (i = 0; filled && i < plan->count; i++)
+        {
+            while (filled[worker] >= (int)((long long)plan->count * (worker + 1) / workers - (long long)plan->count * worker / workers))
+                worker = (worker + 1) % workers;
+            positions[(long long)plan->count * worker / workers + filled[worker]++] = i;
+            worker = (worker + 1) % workers;
+        }
+        free(filled);
+    }
+    for (i = 0; i < workers; i++)
+    {
+        unsigned long long head = (unsigned long long)plan->count * i / workers;
+        unsigned long long tail = (unsigned long long)plan->count * (i + 1) / workers;
+        atomic_init(&queues[i].range, (tail << 32) | head);
+        ctx[i].suite = suite;
+        ctx[i].plan = plan;
+        ctx[i].positions = positions;
+        ctx[i].results = results;
+        ctx[i].queues = queues;
+        ctx[i].workers = workers;
+        ctx[i].id = i;
+    }
+    /* A worker that fails to start just leaves its slice to be stolen */
+    for (i = 1; i < workers; i++)
+    {
+        started[i] = pthread_create(&threads[i], NULL, __CTF_WORKER_MAIN, &ctx[i]) == 0;
+    }
+    char *suite_name = __ctf_current_test_suite_name;
+    __CTF_WORKER_MAIN(&ctx[0]);
+    __ctf_current_test_suite_name = suite_name;
+    for (i = 1; i < workers; i++)
+    {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+    }
+    for (i = 0; i < plan->count; i++)
+    {
+        __CTF_SUMMARY_ADD(summary, &results[i]);
+        __CTF_CACHE_RECORD(suite->name, suite->tests[__CTF_PLAN_AT(plan, i)].test_name, &results[i]);
+        __CTF_REPEAT_RECORD(suite->name, suite->tests[__CTF_PLAN_AT(plan, i)].test_name, &results[i]);
+    }
+    free(positions);
+    free(results);
+    free(queues);
+    free(ctx);
+    free(threads);
+    free(started);
+    return true;
+#else
+    (void)suite;
+    (void)plan;
+    (void)summary;
+    return false;
+#endif
+}
+
+
+/*
+    Process isolation (--isolate).
+
+    Each test runs in its own child process, so a crash, abort() or stack overflow only takes that child down. The
+    children are not forked from the runner itself, which has the log writer and watchdog threads and whatever locks
+    they hold, but from a zygote: one single threaded copy of the runner forked per suite right after its tests are
+    linked and planned, so it already has everything a test needs. The zygote forks a child per test, keeps up to
+    -j of them running and tells the runner about every child it reaps over a pipe. Children send their result over
+    a second pipe before exiting, in one write small enough to be atomic, and write their log output straight to
+    the console and log file. Each completion is answered
+    with a credit byte, so with -j 1 the next test only starts once the runner has printed the previous one.
+
+    Crashes are read from the wait status, signal handlers are off in the children and nothing longjmps. Timeouts
+    still work the usual way, through a watchdog the child starts for itself.
+*/
+
+/* Set with --isolate */
+static bool __ctf_isolate = false;
+
+#ifdef __CTF_POSIX
+typedef struct
+{
+    int position;
+    int wait_status;
+    double elapsed;
+} __CTF_Isolate_Message;
+
+#define __CTF_ISOLATE_RESULT_PART 0
+#define __CTF_ISOLATE_SAMPLES_PART 1
+#define __CTF_ISOLATE_TRACE_PART 2
+
+#define __CTF_ISOLATE_PART_SAMPLES 32
+#define __CTF_ISOLATE_PART_EVENTS 6
+
+/* What a child sends back, in parts well below PIPE_BUF so those of children writing at once never interleave.
+   The baseline samples and the trace events come first, the result last. */
+typedef struct
+{
+    int position;
+    int kind;
+    /* Index of the first sample, or how many trace threads the child numbered */
+    int first;
+    int count;
+    union
+    {
+        __CTF_Test_Result result;
+        double samples[__CTF_ISOLATE_PART_SAMPLES];
+        __CTF_Trace_Event events[__CTF_ISOLATE_PART_EVENTS];
+    } data;
+} __CTF_Isolate_Result;
+
+/* What the runner got from the children of a suite so far, by position in the plan */
+typedef struct
+{
+    __CTF_Test_Result *results;
+    char *received;
+    /* Baseline samples, allocated once a child sends some */
+    double **samples;
+    int *sample_counts;
+    /* Track of the first thread of each child in the runner's numbering, 0 until it sent events */
+    int *trace_threads;
+    int count;
+} __CTF_Isolate_Inbox;
+
+static bool __CTF_FD_WRITE(int fd, const void *data, size_t size)
+{
+    const char *bytes = (const char *)data;
+    while (size > 0)
+    {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        bytes += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+static bool __CTF_FD_READ(int fd, void *data, size_t size)
+{
+    char *bytes = (char *)data;
+    while (size > 0)
+    {
+        ssize_t got = read(fd, bytes, size);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+        bytes += got;
+        size -= (size_t)got;
+    }
+    return true;
+}
+
+/* Drops whatever the ring still held when we were forked, the runner writes that out itself */
+static void __CTF_LOG_DISCARD(void)
+{
+    size_t tail = atomic_load(&__ctf_log_tail), head = atomic_load(&__ctf_log_head);
+    for (; tail != head; tail++)
+    {
+        size_t index = tail & (__CTF_LOG_RING_SLOTS - 1);
+        atomic_store(&__ctf_log_ring[index].sequence, tail + __CTF_LOG_RING_SLOTS - index);
+    }
+    atomic_store(&__ctf_log_tail, tail);
+    atomic_flag_clear(&__ctf_log_draining);
+}
+
+/* Only the forking thread survives fork, forget the runner's threads and whatever they owned */
+static void __CTF_ISOLATE_FORGET_THREADS(void)
+{
+    static const pthread_once_t once = PTHREAD_ONCE_INIT;
+    __CTF_LOG_DISCARD();
+    /* Messages are drained by the process logging them from now on */
+    __ctf_log_writer_started = false;
+    memcpy(&__ctf_watchdog_once, &once, sizeof(once));
+    __ctf_watchdog_started = false;
+    memset(__ctf_watch_slots, 0, sizeof(__ctf_watch_slots));
+    atomic_store(&__ctf_watch_count, 0);
+    __ctf_watch_slot = -1;
+#ifdef __CTF_HAS_PERF_EVENT
+    /* Those counted the runner's thread */
+    __CTF_PERF_RELEASE();
+#endif
+    __CTF_RESET_SIGNAL_HANDLERS();
+    __ctf_use_signal_handlers = false;
+    /* Each test's process sends its own events back, its threads are numbered from 1 */
+    atomic_store(&__ctf_trace_chunks, NULL);
+    atomic_store(&__ctf_trace_threads, 0);
+    __ctf_trace_chunk = NULL;
+    __ctf_trace_thread = 0;
+}
+
+static bool __CTF_ISOLATE_SEND(int fd, int position, int kind, int first, int count, const void *data, size_t size)
+{
+    __CTF_Isolate_Result message;
+    memset(&message, 0, sizeof(message));
+    message.position = position;
+    message.kind = kind;
+    message.first = first;
+    message.count = count;
+    memcpy(&message.data, data, size);
+    return __CTF_FD_WRITE(fd, &message, sizeof(message));
+}
+
+static void __CTF_ISOLATE_CHILD(const __CTF_Test_Suite *suite, const __CTF_Test *test, int position, int result_fd)
+{
+    double samples[__CTF_MAX_SAMPLES];
+    __CTF_Test_Result result;
+    memset(&result, 0, sizeof(result));
+    __CTF_REPORT(test_start, suite->name, test->test_name);
+    int count = __CTF_RUN_TEST_SAMPLED(test, &result, samples), i;
+    if (__ctf_report_file)
+        fflush(__ctf_report_file);
+    fflush(stdout);
+    bool sent = true;
+    for (i = 0; sent && i < count; i += __CTF_ISOLATE_PART_SAMPLES)
+    {
+        int part = count - i < __CTF_ISOLATE_PART_SAMPLES ? count - i : __CTF_ISOLATE_PART_SAMPLES;
+        sent = __CTF_ISOLATE_SEND(result_fd, position, __CTF_ISOLATE_SAMPLES_PART, i, part, samples + i, part * sizeof(double));
+    }
+    __CTF_Trace_Chunk *chunk;
+    int threads = atomic_load(&__ctf_trace_threads);
+    for (chunk = atomic_load(&__ctf_trace_chunks); sent && chunk; chunk = chunk->next)
+    {
+        for (i = 0; i < chunk->count; i++)
+            chunk->events[i].thread = chunk->thread;
+        for (i = 0; sent && i < chunk->count; i += __CTF_ISOLATE_PART_EVENTS)
+        {
+            int part = chunk->count - i < __CTF_ISOLATE_PART_EVENTS ? chunk->count - i : __CTF_ISOLATE_PART_EVENTS;
+            sent = __CTF_ISOLATE_SEND(result_fd, position, __CTF_ISOLATE_TRACE_PART, threads, part, chunk->events + i, part * sizeof(__CTF_Trace_Event));
+        }
+    }
+    _exit(sent && __CTF_ISOLATE_SEND(result_fd, position, __CTF_ISOLATE_RESULT_PART, 0, 1, &result, sizeof(result)) ? 0 : 1);
+}
+
+static void __CTF_ISOLATE_ZYGOTE(const __CTF_Test_Suite *suite, const __CTF_Run_Plan *plan, int done_fd, int credit_fd, int result_fd)
+{
+    __CTF_ISOLATE_FORGET_THREADS();
+    int jobs = __ctf_jobs < 1 ? 1 : __ctf_jobs;
+    pid_t *pids = (pid_t *)calloc(plan->count, sizeof(pid_t));
+    double *starts = (double *)calloc(plan->count, sizeof(double));
+    if (!pids || !starts)
+        _exit(1);
+    int next = 0, running = 0, credits = jobs;
+    while (next < plan->count || running > 0)
+    {
+        while (credits > 0 && next < plan->count)
+        {
+            starts[next] = __CTF_NOW();
+            pid_t pid = fork();
+            if (pid == 0)
+                __CTF_ISOLATE_CHILD(suite, &suite->tests[__CTF_PLAN_AT(plan, next)], next, result_fd);
+            if (pid < 0)
+            {
+                /* -1 tells the runner the test never ran */
+                __CTF_Isolate_Message message = {next, -1, 0};
+                if (!__CTF_FD_WRITE(done_fd, &message, sizeof(message)))
+                    _exit(1);
+                next++;
+                continue;
+            }
+            pids[next++] = pid;
+            running++;
+            credits--;
+        }
+        if (running == 0)
+            break;
+        int wait_status;
+        pid_t pid = waitpid(-1, &wait_status, 0);
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        int position;
+        for (position = 0; position < next && pids[position] != pid; position++)
+            ;
+        if (position == next)
+            continue;
+        running--;
+        __CTF_Isolate_Message message = {position, wait_status, __CTF_NOW() - starts[position]};
+        char credit;
+        if (!__CTF_FD_WRITE(done_fd, &message, sizeof(message)) || !__CTF_FD_READ(credit_fd, &credit, 1))
+            _exit(1);
+        credits++;
+    }
+    _exit(0);
+}
+
+static bool __CTF_ISOLATE_INBOX_INIT(__CTF_Isolate_Inbox *inbox, int count)
+{
+    inbox->count = count;
+    inbox->results = (__CTF_Test_Result *)calloc(count, sizeof(__CTF_Test_Result));
+    inbox->received = (char *)calloc(count, 1);
+    inbox->samples = (double **)calloc(count, sizeof(double *));
+    inbox->sample_counts = (int *)calloc(count, sizeof(int));
+    inbox->trace_threads = (int *)calloc(count, sizeof(int));
+    return inbox->results && inbox->received && inbox->samples && inbox->sample_counts && inbox->trace_threads;
+}
+
+static void __CTF_ISOLATE_INBOX_FREE(__CTF_Isolate_Inbox *inbox)
+{
+    int i;
+    for (i = 0; inbox->samples && i < inbox->count; i++)
+        free(inbox->samples[i]);
+    free(inbox->results);
+    free(inbox->received);
+    free(inbox->samples);
+    free(inbox->sample_counts);
+    free(inbox->trace_threads);
+}
+
+/* Reads every part the children have sent so far, they are all in the pipe before their exit is reported */
+static void __CTF_ISOLATE_COLLECT(int result_fd, __CTF_Isolate_Inbox *inbox)
+{
+    __CTF_Isolate_Result message;
+    while (read(result_fd, &message, sizeof(message)) == (ssize_t)sizeof(message))
+    {
+        int position = message.position, i;
+        if (position < 0 || position >= inbox->count)
+            continue;
+        if (message.kind == __CTF_ISOLATE_RESULT_PART)
+        {
+            inbox->results[position] = message.data.result;
+            inbox->received[position] = 1;
+        }
+        else if (message.kind == __CTF_ISOLATE_SAMPLES_PART)
+        {
+            if (message.first < 0 || message.count < 0 || message.count > __CTF_ISOLATE_PART_SAMPLES || message.first + message.count > __CTF_MAX_SAMPLES)
+                continue;
+            if (!inbox->samples[position])
+                inbox->samples[position] = (double *)malloc(__CTF_MAX_SAMPLES * sizeof(double));
+            if (!inbox->samples[position])
+                continue;
+            memcpy(inbox->samples[position] + message.first, message.data.samples, message.count * sizeof(double));
+            if (inbox->sample_counts[position] < message.first + message.count)
+                inbox->sample_counts[position] = message.first + message.count;
+        }
+        else if (message.kind == __CTF_ISOLATE_TRACE_PART)
+        {
+            /* Give the child's threads tracks of their own next to the runner's */
+            if (!inbox->trace_threads[position])
+                inbox->trace_threads[position] = atomic_fetch_add(&__ctf_trace_threads, message.first) + 1;
+            for (i = 0; i < message.count && i < __CTF_ISOLATE_PART_EVENTS; i++)
+            {
+                __CTF_Trace_Event *event = __CTF_TRACE_EVENT();
+                if (!event)
+                    break;
+                *event = message.data.events[i];
+                event->thread = inbox->trace_threads[position] + message.data.events[i].thread - 1;
+            }
+        }
+    }
+}
+
+/* Turns the wait status of a child into the test's result unless the child sent one and exited normally */
+static void __CTF_ISOLATE_RESULT(const char *test_name, const __CTF_Isolate_Message *message, bool received, __CTF_Test_Result *result)
+{
+    int wait_status = message->wait_status;
+    if (received && wait_status != -1 && WIFEXITED(wait_status) && WEXITSTATUS(wait_status) == 0)
+        return;
+    memset(result, 0, sizeof(*result));
+    result->elapsed = message->elapsed;
+    result->baseline_p = 1;
+    result->case_index = -1;
+    if (wait_status == -1)
+    {
+        result->status = __CTF_TEST_FAILED;
+        __CTF_LOG("%sTest \"%s\" could not be run in an isolated process.%s", __CTF_ANSI_RED, test_name, __CTF_ANSI_RESET);
+    }
+    else if (WIFSIGNALED(wait_status))
+    {
+        result->status = __CTF_TEST_SIGNALED;
+        result->signal = WTERMSIG(wait_status);
+        __CTF_LOG("%sTest \"%s\" was killed by signal %d (%s) in its isolated process.%s", __CTF_ANSI_RED, test_name,
+                  result->signal, strsignal(result->signal), __CTF_ANSI_RESET);
+    }
+    else
+    {
+        result->status = __CTF_TEST_FAILED;
+        __CTF_LOG("%sTest \"%s\" exited with status %d in its isolated process.%s", __CTF_ANSI_RED, test_name,
+                  WEXITSTATUS(wait_status), __CTF_ANSI_RESET);
+    }
+}
+#endif
+
+/**
+ * @brief Runs every test of the plan in its own process forked from a per suite zygote.
+ *
+ * @return false if --isolate is off or the zygote could not be started, the suite then runs in process.
+ */
+static bool __CTF_RUN_TESTS_ISOLATED(const __CTF_Test_Suite *suite, const __CTF_Run_Plan *plan, __CTF_Suite_Summary *summary)
+{
+#ifdef __CTF_POSIX
+    if (!__ctf_isolate || plan->count == 0)
+        return false;
+    __CTF_Isolate_Inbox inbox;
+    bool allocated = __CTF_ISOLATE_INBOX_INIT(&inbox, plan->count);
+    __CTF_Test_Result *results = inbox.results;
+    char *reported = (char *)calloc(plan->count, 1);
+    int done[2] = {-1, -1}, credit[2] = {-1, -1}, result[2] = {-1, -1};
+    if (!allocated || !reported || pipe(done) != 0 || pipe(credit) != 0 || pipe(result) != 0)
+    {
+        int i;
+        for (i = 0; i < 2; i++)
+        {
+            if (done[i] >= 0)
+                close(done[i]);
+            if (credit[i] >= 0)
+                close(credit[i]);
+            if (result[i] >= 0)
+                close(result[i]);
+        }
+        __CTF_ISOLATE_INBOX_FREE(&inbox);
+        free(reported);
+        return false;
+    }
+    fcntl(result[0], F_SETFL, fcntl(result[0], F_GETFL) | O_NONBLOCK);
+    /* Make sure the writer exists before forking, and that nothing buffered gets written twice */
+    pthread_once(&__ctf_log_once, __CTF_LOG_START);
+    __CTF_REPORTERS_INIT();
+    __CTF_LOG_FLUSH();
+    fflush(stdout);
+    if (__ctf_report_file)
+        fflush(__ctf_report_file);
+    pid_t zygote = fork();
+    if (zygote == 0)
+    {
+        close(done[0]);
+        close(credit[1]);
+        close(result[0]);
+        __CTF_ISOLATE_ZYGOTE(suite, plan, done[1], credit[0], result[1]);
+    }
+    close(done[1]);
+    close(credit[0]);
+    close(result[1]);
+    if (zygote < 0)
+    {
+        close(done[0]);
+        close(credit[1]);
+        close(result[0]);
+        __CTF_ISOLATE_INBOX_FREE(&inbox);
+        free(reported);
+        return false;
+    }
+    int count = 0, i;
+    __CTF_Isolate_Message message;
+    while (count < plan->count && __CTF_FD_READ(done[0], &message, sizeof(message)))
+    {
+        if (message.position < 0 || message.position >= plan->count)
+            continue;
+        const __CTF_Test *test = &suite->tests[__CTF_PLAN_AT(plan, message.position)];
+        __CTF_ISOLATE_COLLECT(result[0], &inbox);
+        __ctf_current_test_name = (char *)test->test_name;
+        __CTF_ISOLATE_RESULT(test->test_name, &message, inbox.received[message.position], &results[message.position]);
+        if (results[message.position].status == __CTF_TEST_PASSED && inbox.sample_counts[message.position] > 0)
+            __CTF_BASELINE_RECORD(test, inbox.samples[message.position], inbox.sample_counts[message.position], &results[message.position]);
+        __CTF_SUMMARY_ADD(summary, &results[message.position]);
+        __CTF_CACHE_RECORD(suite->name, test->test_name, &results[message.position]);
+        __CTF_REPEAT_RECORD(suite->name, test->test_name, &results[message.position]);
+        __CTF_REPORT(test_end, suite->name, test->test_name, &results[message.position]);
+        __ctf_current_test_name = NULL;
+        reported[message.position] = 1;
+        count++;
+        /* Let the zygote start the next test only once this one is out, so the console stays in order */
+        __CTF_LOG_FLUSH();
+        if (__ctf_report_file)
+            fflush(__ctf_report_file);
+        char credit_byte = 1;
+        __CTF_FD_WRITE(credit[1], &credit_byte, 1);
+    }
+    close(done[0]);
+    close(credit[1]);
+    close(result[0]);
+    waitpid(zygote, NULL, 0);
+    if (count < plan->count)
+    {
+        __CTF_LOG("%sThe zygote of suite \"%s\" died, %d test(s) were not run.%s", __CTF_ANSI_RED, suite->name, plan->count - count, __CTF_ANSI_RESET);
+        for (i = 0; i < plan->count; i++)
+        {
+            if (reported[i])
+                continue;
+            __CTF_Isolate_Message lost = {i, -1, 0};
+            const __CTF_Test *test = &suite->tests[__CTF_PLAN_AT(plan, i)];
+            __CTF_ISOLATE_RESULT(test->test_name, &lost, false, &results[i]);
+            __CTF_SUMMARY_ADD(summary, &results[i]);
+            __CTF_CACHE_RECORD(suite->name, test->test_name, &results[i]);
+            __CTF_REPEAT_RECORD(suite->name, test->test_name, &results[i]);
+            __CTF_REPORT(test_end, suite->name, test->test_name, &results[i]);
+        }
+    }
+    __CTF_ISOLATE_INBOX_FREE(&inbox);
+    free(reported);
+    return true;
+#else
+    (void)suite;
+    (void)plan;
+    (void)summary;
+    return false;
+#endif
+}
+
+/* Runs a suite hook like a test, named "setup" or "teardown" in the log and the trace */
+static bool __CTF_SUITE_HOOK_RUN(const __CTF_Test_Suite *suite, int (*hook)(), const char *name)
+{
+    __CTF_Test test = {hook, name, suite->name};
+    __CTF_Test_Result result;
+    __CTF_RUN_TEST_ONCE(&test, &result);
+    __ctf_current_test_name = NULL;
+    if (result.status == __CTF_TEST_PASSED)
+        return true;
+    __CTF_LOG("%sThe %s of suite \"%s\" failed.%s", __CTF_ANSI_RED, name, suite->name, __CTF_ANSI_RESET);
+    return false;
+}
+
+/**
+ * @brief Runs the setup hook of suite if it has selected tests.
+ *
+ * @return false if the setup failed, its tests are then already reported as failed.
+ */
+static bool __CTF_SUITE_SETUP_RUN(const __CTF_Test_Suite *suite, const __CTF_Run_Plan *plan, __CTF_Suite_Summary *summary)
+{
+    if (!suite->setup || plan->count == 0 || __CTF_SUITE_HOOK_RUN(suite, suite->setup, "setup"))
+        return true;
+    int i;
+    __CTF_Test_Result result;
+    memset(&result, 0, sizeof(result));
+    result.status = __CTF_TEST_FAILED;
+    result.baseline = __CTF_BASELINE_NONE;
+    result.baseline_p = 1;
+    result.case_index = -1;
+    for (i = 0; i < plan->count; i++)
+    {
+        const char *test_name = suite->tests[__CTF_PLAN_AT(plan, i)].test_name;
+        __CTF_SUMMARY_ADD(summary, &result);
+        __CTF_CACHE_RECORD(suite->name, test_name, &result);
+        __CTF_REPEAT_RECORD(suite->name, test_name, &result);
+        __CTF_REPORT(test_end, suite->name, test_name, &result);
+    }
+    return false;
+}
+
+/* Runs the teardown hook of suite if the setup ran, a failing teardown counts as a failed test of the suite */
+static void __CTF_SUITE_TEARDOWN_RUN(const __CTF_Test_Suite *suite, const __CTF_Run_Plan *plan, __CTF_Suite_Summary *summary)
+{
+    if (suite->teardown && plan->count > 0 && !__CTF_SUITE_HOOK_RUN(suite, suite->teardown, "teardown"))
+        summary->total++;
+}
+
+#define __CTF_SUITE_RUN_TESTS_IMPL(suite)                                                \
+    do                                                                                   \
+    {                                                                                    \
+        int i;                                                                           \
+        double suite_start_time = __CTF_NOW();                                           \
+        unsigned long long suite_start_ns = __CTF_NOW_NS();                              \
+        __CTF_REPORT(suite_start, (suite).name);                                         \
+        __ctf_current_test_suite_name = (char *)(suite).name;                            \
+        __CTF_Suite_Summary summary = {0, 0, 0, 0};                                      \
+        __CTF_Run_Plan plan;                                                             \
+        unsigned long long pass;                                                         \
+        __CTF_PLAN_SUITE(&(suite), &plan);                                               \
+        if (__CTF_SUITE_SETUP_RUN(&(suite), &plan, &summary))                            \
+        {                                                                                \
+            for (pass = 0; __CTF_REPEAT_PASS(&(suite), &plan, pass); pass++)             \
+            {                                                                            \
+                if (__CTF_RUN_TESTS_ISOLATED(&(suite), &plan, &summary) ||               \
+                    __CTF_RUN_TESTS_PARALLEL(&(suite), &plan, &summary))                 \
+                    continue;                                                            \
+                for (i = 0; i < plan.count; i++)                                         \
+                {                                                                        \
+                    const __CTF_Test *test = &(suite).tests[__CTF_PLAN_AT(&plan, i)];    \
+                    __CTF_Test_Result result;                                            \
+                    __CTF_REPORT(test_start, (suite).name, test->test_name);             \
+                    __CTF_RUN_TEST(test, &result);                                       \
+                    __CTF_SUMMARY_ADD(&summary, &result);                                \
+                    __CTF_CACHE_RECORD((suite).name, test->test_name, &result);          \
+                    __CTF_REPEAT_RECORD((suite).name, test->test_name, &result);         \
+                    __CTF_REPORT(test_end, (suite).name, test->test_name, &result);      \
+                }                                                                        \
+            }                                                                            \
+        }                                                                                \
+        __CTF_SUITE_TEARDOWN_RUN(&(suite), &plan, &summary);                             \
+        __CTF_PLAN_FREE(&plan);                                                          \
+        if (__ctf_trace)                                                                 \
+            __CTF_TRACE_COMPLETE((suite).name, "suite", suite_start_ns, __CTF_NOW_NS()); \
+        __ctf_current_test_name = NULL;                                                  \
+        __CTF_REPORT(suite_end, (suite).name, &summary, __CTF_NOW() - suite_start_time); \
+    } while (0)
+
+/**
+ * @brief Defines __CTF_SUITE_RUN_TESTS as a function for preventing variable name reuse.
+ *
+ * @note only declare if your test suite is polluted with local/global variable names.
+ *
+ */
+#if !defined(CTF_SUITE_RUN_TEST_MACRO_ONLY) || defined(CTF_SHARED)
+__CTF_API void __CTF_SUITE_RUN_TESTS(__CTF_Test_Suite suite)
+{
+    __CTF_SUITE_RUN_TESTS_IMPL(suite);
+}
+#else
+#define __CTF_SUITE_RUN_TESTS(suite) __CTF_SUITE_RUN_TESTS_IMPL(suite)
+#endif
+
+/*
+    Parametrized tests.
+
+    The test function of a CTF_TEST_PARAM test walks its whole table in one call. The jump buffer is only armed again
+    after a case crashed, so a run of passing cases costs a call and a clock read each. Every failing case is reported
+    as its own "test[i]" result right away; passing cases only reach the reporters when a machine readable one is
+    listening, the console gets one line for the whole table from the test's own result.
+*/
+
+#define __CTF_PARAM_NAME_SIZE 256
+
+/* Writes "name[index]" after the "name[" prefix already in buffer, without going through printf */
+static void __CTF_PARAM_NAME(char *buffer, size_t prefix, size_t index)
+{
+    char digits[24];
+    int count = 0;
+    do
+    {
+        digits[count++] = (char)('0' + index % 10);
+        index /= 10;
+    } while (index);
+    while (count > 0)
+        buffer[prefix++] = digits[--count];
+    buffer[prefix++] = ']';
+    buffer[prefix] = '\0';
+}
+
+static void __CTF_PARAM_REPORT(const char *name, size_t index, int status, double elapsed)
+{
+    __CTF_Test_Result result;
+    memset(&result, 0, sizeof(result));
+    result.status = status;
+    result.signal = status == __CTF_TEST_PASSED ? 0 : __signal_caught;
+    result.elapsed = elapsed;
+    result.baseline_p = 1;
+    result.case_index = (long)index;
+    __CTF_REPORT(test_end, __ctf_current_test_suite_name, name, &result);
+}
+
+/**
+ * @brief Runs case_func for every index below count on the calling thread and records how each case went.
+ *
+ * @return __CTF_PASS_VALUE if every case passed, like any test function.
+ */
+__CTF_API __CTF_MAYBE_UNUSED int __CTF_PARAM_RUN(const char *test_name, int (*case_func)(size_t), size_t count)
+{
+    char name[__CTF_PARAM_NAME_SIZE + 24];
+    size_t prefix = strlen(test_name);
+    if (prefix > __CTF_PARAM_NAME_SIZE - 2)
+        prefix = __CTF_PARAM_NAME_SIZE - 2;
+    memcpy(name, test_name, prefix);
+    name[prefix++] = '[';
+    /* Machine readable reporters want every case, the console only the failing ones */
+    __CTF_REPORTERS_INIT();
+    bool report_passes = __ctf_reporter_count > (__ctf_log_console ? 1 : 0);
+    char *outer_name = __ctf_current_test_name;
+    __CTF_JMP_BUF outer_env;
+    memcpy(&outer_env, &__ctf_env, sizeof(outer_env));
+    volatile size_t index = 0;
+    volatile long passed = 0;
+    volatile double case_start = 0;
+    while (index < count)
+    {
+        if (__CTF_SETJMP(__ctf_env) != 0)
+        {
+            /* The case at index crashed or the test ran out of time */
+            if (__ctf_timed_out)
+            {
+                __CTF_PARAM_REPORT(name, index, __CTF_TEST_TIMED_OUT, __CTF_NOW() - case_start);
+                __ctf_param_cases = (long)index + 1;
+                __ctf_param_passed = passed;
+                __ctf_current_test_name = outer_name;
+                memcpy(&__ctf_env, &outer_env, sizeof(outer_env));
+                /* Let the runner record the timeout for the test itself */
+                __CTF_LONGJMP(__ctf_env, 1);
+            }
+            __CTF_CRASH_RECOVER();
+            __CTF_PARAM_REPORT(name, index, __CTF_TEST_SIGNALED, __CTF_NOW() - case_start);
+            __CTF_ARENA_RESET();
+            index++;
+            continue;
+        }
+        for (; index < count; index++)
+        {
+            __CTF_PARAM_NAME(name, prefix, index);
+            __ctf_current_test_name = name;
+            case_start = __CTF_NOW();
+            int ret = case_func(index);
+            __CTF_ARENA_RESET();
+            if (ret == __CTF_PASS_VALUE)
+            {
+                passed++;
+                if (report_passes)
+                    __CTF_PARAM_REPORT(name, index, __CTF_TEST_PASSED, __CTF_NOW() - case_start);
+            }
+            else
+            {
+                __CTF_PARAM_REPORT(name, index, __CTF_TEST_FAILED, __CTF_NOW() - case_start);
+            }
+        }
+    }
+    memcpy(&__ctf_env, &outer_env, sizeof(outer_env));
+    __ctf_current_test_name = outer_name;
+    __ctf_param_cases = (long)count;
+    __ctf_param_passed = passed;
+    return passed == (long)count ? __CTF_PASS_VALUE : __CTF_FAIL_VALUE;
 }
 
-static void __CTF_HANDLE_SIGNAL(int sig);
+/*
+    Properties.
 
-/* Register signal handlers macro */
-static void __CTF_REGISTER_SIGNAL_HANDLERS(void)
+    A CTF_PROPERTY body is checked against --prop-runs inputs drawn from a xoshiro256** stream. The stream of each
+    property is seeded from the process seed (--seed, or the clock when it is not given) mixed with the property's
+    name, so --seed replays the exact same inputs whatever else runs. About one draw in eight is an edge value (the
+    bounds, zero and its neighbours) since that is where bugs tend to be. Like parametrized tests, the jump buffer is
+    only armed again after a crash and nothing is allocated while checking.
+
+    The first failing input is shrunk argument by argument toward zero (or the bound closest to it) by halving the
+    distance, keeping each smaller input that still fails, and the smallest one is run once more with logging on so
+    its assertion shows up next to the seed.
+*/
+
+#define __CTF_PROP_MAX_ARGS 16
+#define __CTF_PROP_MAX_SHRINKS 10000
+
+/* Inputs checked per property, set with --prop-runs */
+static unsigned long __ctf_prop_runs = 1000;
+/* The value inputs are shrunk toward, zero if it is in range or else the bound closest to it */
+static long long __CTF_GEN_ORIGIN_INT(const __CTF_Generator *gen)
 {
-    signal(SIGSEGV, __CTF_HANDLE_SIGNAL);
-    signal(SIGFPE, __CTF_HANDLE_SIGNAL);
-    signal(SIGILL, __CTF_HANDLE_SIGNAL);
-    signal(SIGABRT, __CTF_HANDLE_SIGNAL);
+    return gen->lo > 0 ? gen->lo : gen->hi < 0 ? gen->hi : 0;
 }
 
-/* Reset signal handlers macro */
-static void __CTF_RESET_SIGNAL_HANDLERS(void)
+static double __CTF_GEN_ORIGIN_DOUBLE(const __CTF_Generator *gen)
 {
-    signal(SIGSEGV, SIG_DFL);
-    signal(SIGFPE, SIG_DFL);
-    signal(SIGILL, SIG_DFL);
-    signal(SIGABRT, SIG_DFL);
+    return gen->dlo > 0 ? gen->dlo : gen->dhi < 0 ? gen->dhi : 0;
+}
+
+static inline void __CTF_GEN_DRAW(const __CTF_Generator *gen, __CTF_Rng *rng, __CTF_Prop_Value *value)
+{
+    unsigned long long r = __CTF_RNG_NEXT(rng);
+    bool edge = (r & 7) == 0;
+    if (gen->kind == __CTF_GEN_KIND_DOUBLE)
+    {
+        if (edge)
+        {
+            double edges[3] = {gen->dlo, gen->dhi, __CTF_GEN_ORIGIN_DOUBLE(gen)};
+            value->d = edges[(r >> 3) % 3];
+        }
+        else
+        {
+            value->d = gen->dlo + (double)(__CTF_RNG_NEXT(rng) >> 11) * (1.0 / 9007199254740992.0) * (gen->dhi - gen->dlo);
+        }
+        return;
+    }
+    if (edge)
+    {
+        long long origin = __CTF_GEN_ORIGIN_INT(gen);
+        long long edges[5] = {gen->lo, gen->hi, origin, origin < gen->hi ? origin + 1 : origin, origin > gen->lo ? origin - 1 : origin};
+        value->i = edges[(r >> 3) % 5];
+        return;
+    }
+    unsigned long long range = (unsigned long long)gen->hi - (unsigned long long)gen->lo + 1;
+    value->i = (long long)((unsigned long long)gen->lo + __CTF_RNG_BELOW(rng, range));
 }
 
-#define __CTF_SIGBUFF_SIZE 60
-#define __CTF_ERRBUFF_SIZE (__CTF_SIGBUFF_SIZE + 150)
-#define __CTF_BUFF_SIZE (__CTF_ERRBUFF_SIZE + 150)
+/* Runs the body once under its own jump buffer, true if it failed or crashed */
+static bool __CTF_PROPERTY_FAILS(int (*body)(const __CTF_Prop_Value *), const __CTF_Prop_Value *args)
+{
+    bool failed;
+    if (__CTF_SETJMP(__ctf_env) == 0)
+    {
+        failed = body(args) != __CTF_PASS_VALUE;
+    }
+    else
+    {
+        if (__ctf_timed_out)
+            return true;
+        failed = true;
+        __CTF_CRASH_RECOVER();
+    }
+    __CTF_ARENA_RESET();
+    return failed;
+}
 
-/* Signal handling functions */
-static void __CTF_HANDLE_SIGNAL(int sig)
+/* Shrinks args in place to a smaller input that still fails, returns the number of successful shrink steps */
+static int __CTF_PROPERTY_SHRINK(int (*body)(const __CTF_Prop_Value *), const __CTF_Generator *gens, int count, __CTF_Prop_Value *args)
 {
-    if (!__ctf_use_signal_handlers)
+    int steps = 0, attempts = 0, i;
+    bool improved = true;
+    while (improved && attempts < __CTF_PROP_MAX_SHRINKS && !__ctf_timed_out)
     {
-        fprintf(stderr, "Warning: signal handler called despite being disabled.\n");
+        improved = false;
+        for (i = 0; i < count && !__ctf_timed_out; i++)
+        {
+            __CTF_Prop_Value saved = args[i];
+            if (gens[i].kind == __CTF_GEN_KIND_DOUBLE)
+            {
+                double origin = __CTF_GEN_ORIGIN_DOUBLE(&gens[i]), distance = args[i].d - origin;
+                /* Stop once the remaining distance no longer changes the value */
+                while (saved.d - distance != saved.d && attempts < __CTF_PROP_MAX_SHRINKS && !__ctf_timed_out)
+                {
+                    args[i].d = saved.d - distance;
+                    attempts++;
+                    if (__CTF_PROPERTY_FAILS(body, args))
+                    {
+                        saved = args[i];
+                        improved = true;
+                        steps++;
+                        distance = args[i].d - origin;
+                    }
+                    else
+                    {
+                        args[i] = saved;
+                        distance /= 2;
+                    }
+                }
+            }
+            else
+            {
+                long long origin = __CTF_GEN_ORIGIN_INT(&gens[i]);
+                /* Distances can span the whole 64 bit range, so they are kept unsigned */
+                bool above = args[i].i > origin;
+                unsigned long long distance = above ? (unsigned long long)args[i].i - (unsigned long long)origin
+                                                    : (unsigned long long)origin - (unsigned long long)args[i].i;
+                while (distance > 0 && attempts < __CTF_PROP_MAX_SHRINKS && !__ctf_timed_out)
+                {
+                    args[i].i = (long long)(above ? (unsigned long long)saved.i - distance : (unsigned long long)saved.i + distance);
+                    attempts++;
+                    if (__CTF_PROPERTY_FAILS(body, args))
+                    {
+                        saved = args[i];
+                        improved = true;
+                        steps++;
+                        distance = above ? (unsigned long long)saved.i - (unsigned long long)origin
+                                         : (unsigned long long)origin - (unsigned long long)saved.i;
+                    }
+                    else
+                    {
+                        args[i] = saved;
+                        distance /= 2;
+                    }
+                }
+            }
+        }
     }
+    return steps;
+}
 
-    const char *signal_name;
-    switch (sig)
+static void __CTF_PROPERTY_REPORT(const char *name, const __CTF_Generator *gens, int count, const __CTF_Prop_Value *args, unsigned long run, int steps)
+{
+    char text[__CTF_LOG_BUFFER_SIZE];
+    size_t length = 0;
+    int i;
+    for (i = 0; i < count; i++)
     {
-    case SIGSEGV:
-        signal_name = "Segmentation fault";
-        break;
-    case SIGFPE:
-        signal_name = "Floating point exception";
-        break;
-    case SIGILL:
-        signal_name = "Illegal instruction";
-        break;
-    case SIGABRT:
-        signal_name = "Aborted";
-        break;
-    default:
-        signal_name = "Unknown signal";
+        if (gens[i].kind == __CTF_GEN_KIND_DOUBLE)
+            length = __CTF_LOG_FORMAT_ARGS(text, length, "\n\t\targ %d = %.17g", i, args[i].d);
+        else
+            length = __CTF_LOG_FORMAT_ARGS(text, length, "\n\t\targ %d = %lld", i, args[i].i);
     }
-    char sigbuff[__CTF_SIGBUFF_SIZE], errbuff[__CTF_ERRBUFF_SIZE], buff[__CTF_BUFF_SIZE];
+    text[length] = '\0';
+    __CTF_LOG("\n\t%sProperty %s\"%s\"%s falsified after %lu input(s), shrunk %d time(s). Rerun with --seed %llu%s\n\tCounterexample:%s",
+              __CTF_ANSI_RED, __CTF_ANSI_YELLOW, name, __CTF_ANSI_RED, run, steps, __CTF_SEED(), __CTF_ANSI_RESET, text);
+}
 
-    snprintf(sigbuff, __CTF_SIGBUFF_SIZE, "\n\tCaught signal: %s (%d)\n", signal_name, sig);
-    if (__ctf_current_test_name != NULL)
+/**
+ * @brief Checks body against --prop-runs generated inputs and shrinks the first one that fails.
+ *
+ * @return __CTF_PASS_VALUE or __CTF_FAIL_VALUE, like any test function.
+ */
+__CTF_API __CTF_MAYBE_UNUSED int __CTF_PROPERTY_RUN(const char *name, int (*body)(const __CTF_Prop_Value *), const __CTF_Generator *gens, int count)
+{
+    if (count > __CTF_PROP_MAX_ARGS)
     {
-        snprintf(errbuff, __CTF_ERRBUFF_SIZE, "%s\tError occurred during test: %s\n", sigbuff, __ctf_current_test_name);
+        __CTF_LOG("%sProperty \"%s\" has %d generators, at most %d are supported.%s", __CTF_ANSI_RED, name, count, __CTF_PROP_MAX_ARGS, __CTF_ANSI_RESET);
+        return __CTF_FAIL_VALUE;
     }
-    if (__ctf_current_test_suite_name != NULL)
+    __CTF_Rng rng;
+    __CTF_RNG_SEED(&rng, __CTF_SEED(), name);
+    __CTF_Prop_Value args[__CTF_PROP_MAX_ARGS];
+    __CTF_JMP_BUF outer_env;
+    memcpy(&outer_env, &__ctf_env, sizeof(outer_env));
+    volatile unsigned long run = 0;
+    volatile bool failed = false;
+    int i;
+    __ctf_log_muted = true;
+    if (__CTF_SETJMP(__ctf_env) != 0)
     {
-        snprintf(buff, __CTF_BUFF_SIZE, "%s\tIn test suite: %s", errbuff, __ctf_current_test_suite_name);
+        failed = true;
+        if (!__ctf_timed_out)
+            __CTF_CRASH_RECOVER();
     }
-    __CTF_LOG("%s%s%s", __CTF_ANSI_RED, buff, __CTF_ANSI_RESET);
-    /*  Reset signal handlers to default */
-    __CTF_RESET_SIGNAL_HANDLERS();
+    while (!failed && run < __ctf_prop_runs)
+    {
+        for (i = 0; i < count; i++)
+            __CTF_GEN_DRAW(&gens[i], &rng, &args[i]);
+        run++;
+        failed = body(args) != __CTF_PASS_VALUE;
+        __CTF_ARENA_RESET();
+    }
+    if (!failed)
+    {
+        __ctf_log_muted = false;
+        memcpy(&__ctf_env, &outer_env, sizeof(outer_env));
+        return __CTF_PASS_VALUE;
+    }
+    /* The args of the failing run are still in place, the body only reads them */
+    int steps = __ctf_timed_out ? 0 : __CTF_PROPERTY_SHRINK(body, gens, count, args);
+    __ctf_log_muted = false;
+    __CTF_PROPERTY_REPORT(name, gens, count, args, run, steps);
+    memcpy(&__ctf_env, &outer_env, sizeof(outer_env));
+    if (__ctf_timed_out)
+        __CTF_LONGJMP(__ctf_env, 1);
+    /* Once more with logging so the failing assertion or signal shows up, a crash is then recorded by the runner */
+    body(args);
+    return __CTF_FAIL_VALUE;
+}
+
+/*
+    Benchmarks.
+
+    A benchmark body is called repeatedly with a growing iteration count until one call of CTF_BENCH_LOOP takes about
+    __ctf_bench_time / __ctf_bench_samples (this also serves as warmup), then __ctf_bench_samples more times. Only
+    the loop itself is timed, so setup before it is free. Each sample is turned into ns per iteration.
+
+    CTF_BENCH_RANGE measures the body like that once per input size N of a geometric range, splitting the time
+    between the sizes, then fits the median times to O(1), O(log N), O(N), O(N log N) and O(N^2) by least squares.
+    The model with the smallest RMS error relative to the mean time is reported. With CTF_EXPECT_COMPLEXITY the
+    benchmark fails when a higher order fits better and the expected model is off by more than
+    __CTF_COMPLEXITY_TOLERANCE.
+*/
+
+#define __CTF_BENCH_MAX_SAMPLES 1000
+#define __CTF_BENCH_MAX_SIZES 64
+
+#define __CTF_COMPLEXITIES 5
+#define __CTF_COMPLEXITY_TOLERANCE 0.2
+
+/* Total seconds to spend measuring each benchmark, set with --bench-time */
+static double __ctf_bench_time = 0.5;
+/* Number of timed samples per benchmark, set with --bench-samples */
+static int __ctf_bench_samples = 50;
+
+static const char *const __ctf_complexity_names[__CTF_COMPLEXITIES] = {"O(1)", "O(log N)", "O(N)", "O(N log N)", "O(N^2)"};
+static const char *const __ctf_complexity_terms[__CTF_COMPLEXITIES] = {"1", "log N", "N", "N log N", "N^2"};
+
+/* Result lines are built here before going to __CTF_LOG, which has its own buffer */
+static __CTF_THREAD_LOCAL char __ctf_bench_buffer[__CTF_LOG_BUFFER_SIZE];
+static __CTF_THREAD_LOCAL char __ctf_bench_range_buffer[__CTF_LOG_BUFFER_SIZE];
+
+/* Nanoseconds per tsc tick, 0 if the tsc can't be trusted and the monotonic clock is used instead */
+static double __ctf_ns_per_tick = -1;
+#ifdef __CTF_POSIX
+static pthread_once_t __ctf_bench_clock_once = PTHREAD_ONCE_INIT;
+#endif
+
+static void __CTF_BENCH_CLOCK_INIT(void)
+{
+    __ctf_ns_per_tick = 0;
+#if defined(__CTF_HAS_RDTSC) && defined(__CTF_POSIX)
+    unsigned int eax, ebx, ecx, edx;
+    /* Only an invariant tsc ticks at a constant rate across frequency changes and cores */
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8)))
+        return;
+    unsigned long long ns_start = __CTF_NOW_NS(), tick_start = __rdtsc();
+    while (__CTF_NOW_NS() - ns_start < 10000000ull)
+        ;
+    unsigned long long ns = __CTF_NOW_NS() - ns_start, ticks = __rdtsc() - tick_start;
+    if (ticks > 0)
+        __ctf_ns_per_tick = (double)ns / (double)ticks;
+#endif
+}
+
+/* Calibrates once before the first benchmark, -j workers wait for it rather than timing with a half set clock */
+static void __CTF_BENCH_CLOCK_READY(void)
+{
+#ifdef __CTF_POSIX
+    pthread_once(&__ctf_bench_clock_once, __CTF_BENCH_CLOCK_INIT);
+#else
+    if (__ctf_ns_per_tick < 0)
+        __CTF_BENCH_CLOCK_INIT();
+#endif
+}
+
+static unsigned long long __CTF_BENCH_TICKS(void)
+{
+#ifdef __CTF_HAS_RDTSC
+    if (__ctf_ns_per_tick > 0)
+        return __rdtsc();
+#endif
+    return __CTF_NOW_NS();
+}
+
+static unsigned long long __CTF_BENCH_TICKS_TO_NS(unsigned long long ticks)
+{
+    return __ctf_ns_per_tick > 0 ? (unsigned long long)(ticks * __ctf_ns_per_tick) : ticks;
+}
+
+__CTF_API __CTF_MAYBE_UNUSED void __CTF_BENCH_BEGIN(__CTF_Bench *bench)
+{
+    bench->looped = true;
+    bench->remaining = bench->iterations;
+    bench->start = __CTF_BENCH_TICKS();
+}
 
-    if (__ctf_handle_signal_ask_user)
+__CTF_API __CTF_MAYBE_UNUSED bool __CTF_BENCH_END(__CTF_Bench *bench)
+{
+    bench->elapsed_ns = __CTF_BENCH_TICKS_TO_NS(__CTF_BENCH_TICKS() - bench->start);
+    return false;
+}
+
+static int __CTF_BENCH_SAMPLE_COUNT(void)
+{
+    int samples = __ctf_bench_samples;
+    if (samples < 1)
+        samples = 1;
+    if (samples > __CTF_BENCH_MAX_SAMPLES)
+        samples = __CTF_BENCH_MAX_SAMPLES;
+    return samples;
+}
+
+/**
+ * @brief Calibrates the body to sample_ns per sample and fills per_op with samples ns per iteration timings, unsorted.
+ *
+ * @return false if the body failed or never entered the loop.
+ */
+static bool __CTF_BENCH_MEASURE(const char *name, int (*body)(__CTF_Bench *), __CTF_Bench *bench, double sample_ns, double *per_op, int samples)
+{
+    /* Calibration doubles as warmup */
+    for (;;)
     {
-        printf("Do you want to continue testing? ");
-        if (!__CTF_ASK_USER())
+        if (body(bench) != __CTF_PASS_VALUE)
+            return false;
+        if (!bench->looped)
         {
-            __CTF_LOG("User chose to exit after signal %d.", sig);
-            __CTF_PROCESS_EXIT_IMPL();
-            return;
+            __CTF_LOG("%sBenchmark \"%s\" never entered CTF_BENCH_LOOP.%s", __CTF_ANSI_RED, name, __CTF_ANSI_RESET);
+            return false;
         }
+        if (bench->elapsed_ns >= sample_ns || bench->iterations >= (1ull << 40))
+            break;
+        double scale = bench->elapsed_ns > 0 ? sample_ns / bench->elapsed_ns * 1.2 : 100;
+        if (scale < 2)
+            scale = 2;
+        if (scale > 100)
+            scale = 100;
+        bench->iterations = (unsigned long long)(bench->iterations * scale);
     }
-    __signal_caught = sig;
-    /* Jump back to tests */
-    longjmp(__ctf_env, 1);
-}
-
-#define __CTF_SUITE_RUN_TESTS_IMPL(suite)                                                                                                                                                \
-    do                                                                                                                                                                                   \
-    {                                                                                                                                                                                    \
-        int i;                                                                                                                                                                           \
-        printf("%s%sRunning Test Suite: %s\n%s", __CTF_ANSI_UNDERLINE, __CTF_ANSI_YELLOW, (suite).name, __CTF_ANSI_RESET);                                                               \
-        __ctf_current_test_suite_name = (char *)(suite).name;                                                                                                                            \
-        int total_tests = 0, passed_tests = 0;                                                                                                                                           \
-        for (i = 0; i < (suite).count; i++)                                                                                                                                              \
-        {                                                                                                                                                                                \
-            total_tests++;                                                                                                                                                               \
-            __ctf_current_test_name = (char *)(suite).tests[i].test_name;                                                                                                                \
-            clock_t start = clock();                                                                                                                                                     \
-            printf("%sRunning Test: %s%s%s...\n%s", __CTF_ANSI_BLUE, __CTF_ANSI_YELLOW, __ctf_current_test_name, __CTF_ANSI_BLUE, __CTF_ANSI_RESET);                                     \
-            if (setjmp(__ctf_env) == 0)                                                                                                                                                  \
-            {                                                                                                                                                                            \
-                __signal_caught = 0;                                                                                                                                                     \
-                int result = (suite).tests[i].test_func();                                                                                                                               \
-                if (result == __CTF_PASS_VALUE && __signal_caught == 0)                                                                                                                  \
-                {                                                                                                                                                                        \
-                    printf("%sTest %s\"%s\"%s passed.%s\n", __CTF_ANSI_GREEN, __CTF_ANSI_YELLOW, __ctf_current_test_name, __CTF_ANSI_GREEN, __CTF_ANSI_RESET);                           \
-                    passed_tests++;                                                                                                                                                      \
-                }                                                                                                                                                                        \
-                else                                                                                                                                                                     \
-                {                                                                                                                                                                        \
-                    printf("%sTest \"%s\" failed.\n%s", __CTF_ANSI_RED, __ctf_current_test_name, __CTF_ANSI_RESET);                                                                      \
-                }                                                                                                                                                                        \
-            }                                                                                                                                                                            \
-            else                                                                                                                                                                         \
-            {                                                                                                                                                                            \
-                printf("%sTest %s\"%s\"%s failed due to signal %d.%s\n", __CTF_ANSI_RED, __CTF_ANSI_YELLOW, __ctf_current_test_name, __CTF_ANSI_RED, __signal_caught, __CTF_ANSI_RESET); \
-            }                                                                                                                                                                            \
-            clock_t end = clock();                                                                                                                                                       \
-            double elapsed_time = (double)(end - start) / CLOCKS_PER_SEC;                                                                                                                \
-            printf("\t%sElapsed time: %fs%s\n", __CTF_ANSI_YELLOW, elapsed_time, __CTF_ANSI_RESET);                                                                                      \
-        }                                                                                                                                                                                \
-        __ctf_current_test_name = NULL;                                                                                                                                                  \
-        __CTF_LOG("\nTest suite %s\"%s\"%s summary:\n%sTotal tests: %d\n%sPassed tests: %d\n%sFailed tests: %d\n%sPass rate: %.2f%%%s",                                                  \
-                  __CTF_ANSI_YELLOW, __ctf_current_test_suite_name, __CTF_ANSI_RESET,                                                                                                    \
-                  __CTF_ANSI_BLUE, total_tests,                                                                                                                                          \
-                  __CTF_ANSI_GREEN, passed_tests,                                                                                                                                        \
-                  __CTF_ANSI_RED, total_tests - passed_tests,                                                                                                                            \
-                  __CTF_ANSI_YELLOW, (float)passed_tests / total_tests * 100, __CTF_ANSI_RESET);                                                                                         \
-    } while (0)
+    int i;
+    for (i = 0; i < samples; i++)
+    {
+        if (body(bench) != __CTF_PASS_VALUE)
+            return false;
+        per_op[i] = (double)bench->elapsed_ns / bench->iterations;
+    }
+    return true;
+}
+
+/* Hands the samples to --save-baseline/--compare-baseline when the runner asked for them */
+static void __CTF_BENCH_SINK(const double *per_op, int samples)
+{
+    if (!__ctf_sample_sink)
+        return;
+    int i;
+    /* Baselines are kept in seconds */
+    for (i = 0; i < samples; i++)
+        __ctf_sample_sink[i] = per_op[i] * 1e-9;
+    __ctf_sample_sink_count = samples;
+}
+
+/* Appends ", 12.3 M items/s, 45.6 MiB/s" for whatever the body set with CTF_SET_ITEMS and CTF_SET_BYTES */
+static size_t __CTF_BENCH_RATES(char *buffer, size_t offset, const __CTF_Bench *bench, double ns_per_op)
+{
+    static const char *const si[] = {"", " k", " M", " G", " T"};
+    static const char *const binary[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    if (ns_per_op <= 0)
+        return offset;
+    if (bench->items)
+    {
+        double rate = bench->items * 1e9 / ns_per_op;
+        int unit = 0;
+        while (rate >= 1000 && unit < 4)
+        {
+            rate /= 1000;
+            unit++;
+        }
+        offset = __CTF_LOG_FORMAT_ARGS(buffer, offset, ", %.3g%s items/s", rate, si[unit]);
+    }
+    if (bench->bytes)
+    {
+        double rate = bench->bytes * 1e9 / ns_per_op;
+        int unit = 0;
+        while (rate >= 1024 && unit < 4)
+        {
+            rate /= 1024;
+            unit++;
+        }
+        offset = __CTF_LOG_FORMAT_ARGS(buffer, offset, ", %.3g %s/s", rate, binary[unit]);
+    }
+    return offset;
+}
 
 /**
- * @brief Defines __CTF_SUITE_RUN_TESTS as a function for preventing variable name reuse.
+ * @brief Calibrates and measures one benchmark body then logs its statistics.
  *
- * @note only declare if your test suite is polluted with local/global variable names.
+ * @return __CTF_PASS_VALUE or __CTF_FAIL_VALUE, like any test function.
+ */
+__CTF_API __CTF_MAYBE_UNUSED int __CTF_BENCH_RUN(const char *name, int (*body)(__CTF_Bench *))
+{
+    __CTF_BENCH_CLOCK_READY();
+    int samples = __CTF_BENCH_SAMPLE_COUNT();
+    __CTF_Bench bench = {1, 0, 0, 0, false, 0, 0, 0, -1};
+    double per_op[__CTF_BENCH_MAX_SAMPLES];
+    if (!__CTF_BENCH_MEASURE(name, body, &bench, __ctf_bench_time * 1e9 / samples, per_op, samples))
+        return __CTF_FAIL_VALUE;
+    __CTF_BENCH_SINK(per_op, samples);
+    double sum = 0;
+    int i;
+    for (i = 0; i < samples; i++)
+        sum += per_op[i];
+    qsort(per_op, samples, sizeof(double), __CTF_DOUBLE_COMPARE);
+    double mean = sum / samples, variance = 0;
+    for (i = 0; i < samples; i++)
+        variance += (per_op[i] - mean) * (per_op[i] - mean);
+    double stddev = samples > 1 ? __CTF_SQRT(variance / (samples - 1)) : 0;
+    double median = samples % 2 ? per_op[samples / 2] : (per_op[samples / 2 - 1] + per_op[samples / 2]) / 2;
+    /* Nearest rank */
+    int p99 = (samples * 99 + 99) / 100 - 1;
+    size_t rates = __CTF_BENCH_RATES(__ctf_bench_buffer, 0, &bench, median);
+    __CTF_LOG("\n\t%sBenchmark %s\"%s\"%s: %llu iterations x %d samples (%s)%s"
+              "\n\t\tmin: %.2f ns/op\n\t\tmedian: %.2f ns/op\n\t\tmean: %.2f ns/op\n\t\tp99: %.2f ns/op\n\t\tstddev: %.2f ns/op (%.2f%%)"
+              "\n\t\tthroughput: %.0f ops/s%s",
+              __CTF_ANSI_BLUE, __CTF_ANSI_YELLOW, name, __CTF_ANSI_BLUE, bench.iterations, samples, __ctf_ns_per_tick > 0 ? "tsc" : "monotonic clock", __CTF_ANSI_RESET,
+              per_op[0], median, mean, per_op[p99 < 0 ? 0 : p99], stddev, mean > 0 ? stddev / mean * 100 : 0,
+              median > 0 ? 1e9 / median : 0, rates ? __ctf_bench_buffer : "");
+    return __CTF_PASS_VALUE;
+}
+
+/* log2 without libm, enough precision for fitting */
+static double __CTF_LOG2(double x)
+{
+    if (x <= 0)
+        return 0;
+    double result = 0;
+    while (x >= 2)
+    {
+        x /= 2;
+        result++;
+    }
+    while (x < 1)
+    {
+        x *= 2;
+        result--;
+    }
+    /* ln(x) = 2 atanh((x - 1) / (x + 1)) for x in [1, 2) */
+    double y = (x - 1) / (x + 1), y2 = y * y, term = y, sum = 0;
+    int i;
+    for (i = 1; i < 40; i += 2)
+    {
+        sum += term / i;
+        term *= y2;
+    }
+    return result + 2 * sum / 0.69314718055994530942;
+}
+
+static double __CTF_COMPLEXITY_TERM(int order, double n)
+{
+    switch (order)
+    {
+    case __CTF_O_LOG_N:
+        return __CTF_LOG2(n);
+    case __CTF_O_N:
+        return n;
+    case __CTF_O_N_LOG_N:
+        return n * __CTF_LOG2(n);
+    case __CTF_O_N_SQUARED:
+        return n * n;
+    default:
+        return 1;
+    }
+}
+
+/**
+ * @brief Fits times = coefficient * f(N) for every model by least squares.
  *
+ * @return The model with the smallest RMS error, which is relative to the mean time.
  */
-#ifndef CTF_SUITE_RUN_TEST_MACRO_ONLY
-static void __CTF_SUITE_RUN_TESTS(__CTF_Test_Suite suite)
+static int __CTF_COMPLEXITY_FIT(const long long *sizes, const double *times, int count, double *coefficients, double *rms)
 {
-    __CTF_SUITE_RUN_TESTS_IMPL(suite);
+    double mean = 0;
+    int order, i, best = 0;
+    for (i = 0; i < count; i++)
+        mean += times[i];
+    mean /= count;
+    for (order = 0; order < __CTF_COMPLEXITIES; order++)
+    {
+        double dot = 0, norm = 0, error = 0;
+        for (i = 0; i < count; i++)
+        {
+            double term = __CTF_COMPLEXITY_TERM(order, (double)sizes[i]);
+            dot += term * times[i];
+            norm += term * term;
+        }
+        coefficients[order] = norm > 0 ? dot / norm : 0;
+        for (i = 0; i < count; i++)
+        {
+            double residual = times[i] - coefficients[order] * __CTF_COMPLEXITY_TERM(order, (double)sizes[i]);
+            error += residual * residual;
+        }
+        rms[order] = mean > 0 ? __CTF_SQRT(error / count) / mean : 0;
+        if (rms[order] < rms[best])
+            best = order;
+    }
+    return best;
+}
+
+/**
+ * @brief Measures the body at every size of the range, logs the timings and the best fitting complexity.
+ *
+ * @return __CTF_FAIL_VALUE if the body failed or fits a higher complexity than CTF_EXPECT_COMPLEXITY allows.
+ */
+__CTF_API __CTF_MAYBE_UNUSED int __CTF_BENCH_RANGE_RUN(const char *name, int (*body)(__CTF_Bench *), long long lo, long long hi, long long multiplier)
+{
+    if (lo < 1 || hi < lo || multiplier < 2)
+    {
+        __CTF_LOG("%sBenchmark \"%s\" needs 1 <= lo <= hi and a multiplier of at least 2.%s", __CTF_ANSI_RED, name, __CTF_ANSI_RESET);
+        return __CTF_FAIL_VALUE;
+    }
+    __CTF_BENCH_CLOCK_READY();
+    long long sizes[__CTF_BENCH_MAX_SIZES];
+    double medians[__CTF_BENCH_MAX_SIZES];
+    int count = 0, i;
+    long long n;
+    /* lo, lo * multiplier, ... and always hi itself */
+    for (n = lo; count < __CTF_BENCH_MAX_SIZES; n = n > hi / multiplier ? hi : n * multiplier)
+    {
+        sizes[count++] = n;
+        if (n == hi)
+            break;
+    }
+    int samples = __CTF_BENCH_SAMPLE_COUNT();
+    double sample_ns = __ctf_bench_time * 1e9 / samples / count;
+    double per_op[__CTF_BENCH_MAX_SAMPLES];
+    int expected = -1;
+    size_t length = __CTF_LOG_FORMAT_ARGS(__ctf_bench_range_buffer, 0, "\n\t%sBenchmark %s\"%s\"%s: %d sizes x %d samples (%s)%s",
+                                          __CTF_ANSI_BLUE, __CTF_ANSI_YELLOW, name, __CTF_ANSI_BLUE, count, samples,
+                                          __ctf_ns_per_tick > 0 ? "tsc" : "monotonic clock", __CTF_ANSI_RESET);
+    for (i = 0; i < count; i++)
+    {
+        /* Each size calibrates its own iteration count */
+        __CTF_Bench step = {1, 0, 0, 0, false, sizes[i], 0, 0, -1};
+        if (!__CTF_BENCH_MEASURE(name, body, &step, sample_ns, per_op, samples))
+            return __CTF_FAIL_VALUE;
+        qsort(per_op, samples, sizeof(double), __CTF_DOUBLE_COMPARE);
+        medians[i] = samples % 2 ? per_op[samples / 2] : (per_op[samples / 2 - 1] + per_op[samples / 2]) / 2;
+        size_t rates = __CTF_BENCH_RATES(__ctf_bench_buffer, 0, &step, medians[i]);
+        length = __CTF_LOG_FORMAT_ARGS(__ctf_bench_range_buffer, length, "\n\t\tN = %lld: %.2f ns/op%s", sizes[i], medians[i], rates ? __ctf_bench_buffer : "");
+        expected = step.expected;
+    }
+    /* The largest size stands for the whole range in baselines */
+    __CTF_BENCH_SINK(per_op, samples);
+    int status = __CTF_PASS_VALUE;
+    if (count >= 2)
+    {
+        double coefficients[__CTF_COMPLEXITIES], rms[__CTF_COMPLEXITIES];
+        int best = __CTF_COMPLEXITY_FIT(sizes, medians, count, coefficients, rms);
+        length = __CTF_LOG_FORMAT_ARGS(__ctf_bench_range_buffer, length, "\n\t\tcomplexity: %s, %.4g ns x %s, RMS %.1f%%",
+                                       __ctf_complexity_names[best], coefficients[best], __ctf_complexity_terms[best], rms[best] * 100);
+        if (expected >= 0 && expected < __CTF_COMPLEXITIES && best > expected && rms[expected] > __CTF_COMPLEXITY_TOLERANCE)
+        {
+            length = __CTF_LOG_FORMAT_ARGS(__ctf_bench_range_buffer, length, "\n\t\t%sexpected %s, which is off by RMS %.1f%%%s",
+                                           __CTF_ANSI_RED, __ctf_complexity_names[expected], rms[expected] * 100, __CTF_ANSI_RESET);
+            status = __CTF_FAIL_VALUE;
+        }
+    }
+    (void)length;
+    __CTF_LOG("%s", __ctf_bench_range_buffer);
+    return status;
 }
-#else
-#define __CTF_SUITE_RUN_TESTS(suite) __CTF_SUITE_RUN_TESTS_IMPL(suite)
-#endif
 
-static void __CTF_SUITE_LINK_IMPL(__CTF_Test_Suite *suite, int (*test_func)(), const char *test_name)
+__CTF_API __CTF_MAYBE_UNUSED void __CTF_SUITE_LINK_IMPL(__CTF_Test_Suite *suite, int (*test_func)(), const char *test_name)
 {
     if (!suite)
     {
@@ -590,81 +7081,181 @@ static void __CTF_SUITE_LINK_IMPL(__CTF_Test_Suite *suite, int (*test_func)(), c
     }
     suite->tests[suite->count].test_func = test_func;
     suite->tests[suite->count].test_name = test_name;
+    suite->tests[suite->count].suite_name = suite->name;
     suite->count++;
 }
 
-#define __CTF_SUITE_INIT_IMPL(name)                                                                                             \
-    __ctf_current_test_suite_name = #name;                                                                                      \
-    int __CTF_SUITE_INIT_IMPL_i = 22 + ((sizeof(#name) / sizeof(char)) - 3), __CTF_SUITE_INIT_IMPL_j = __CTF_SUITE_INIT_IMPL_i; \
-    while (__CTF_SUITE_INIT_IMPL_i--)                                                                                           \
-    {                                                                                                                           \
-        putchar('+');                                                                                                           \
-    }                                                                                                                           \
-    putchar('\n');                                                                                                              \
-    __CTF_LOG_TIME();
+/* Runs the function made by __CTF_SUITE_MAKE, which links the suite's tests and runs them */
+__CTF_API __CTF_MAYBE_UNUSED void __CTF_RUN_SUITE(const char *name, void (*suite_func)())
+{
+    if (!__CTF_FILTER_SUITE(name))
+        return;
+    if (__ctf_use_signal_handlers)
+        __CTF_REGISTER_SIGNAL_HANDLERS();
+    suite_func();
+    /* Suites are counted once however many passes they run */
+    if (!__ctf_repeat_outer || __ctf_iteration == 0)
+        __ctf_suites_ran++;
+    if (__ctf_use_signal_handlers)
+        __CTF_RESET_SIGNAL_HANDLERS();
+}
 
-#define __CTF_SUITE_IMPL(name, ...)  \
-    __CTF_SUITE_MAKE(name)           \
-    {                                \
-        __CTF_SUITE_INIT_IMPL(name); \
-        __CTF_BLOCK(__VA_ARGS__);    \
-        __CTF_SUITE_END(name);       \
+static void __CTF_RUN_SUITE_ENTRY(const void *entries, int index)
+{
+    const __CTF_Suite_Entry *entry = (const __CTF_Suite_Entry *)entries + index;
+    __CTF_RUN_SUITE(entry->name, entry->suite_func);
+}
+
+/* Runs the suites from begin to end in order, or pass after pass when repeating */
+static void __CTF_RUN_SUITE_ENTRIES(const __CTF_Suite_Entry *begin, const __CTF_Suite_Entry *end)
+{
+    if (!begin || begin >= end)
+        return;
+    if (__CTF_REPEATING())
+    {
+        __CTF_REPEAT_SUITES(begin, (int)(end - begin), __CTF_RUN_SUITE_ENTRY);
+        return;
     }
+    for (; begin < end; begin++)
+        __CTF_RUN_SUITE(begin->name, begin->suite_func);
+}
 
-#define __CTF_LOG_TIME_IMPL()                                    \
-    {                                                            \
-        time_t t;                                                \
-        time(&t);                                                \
-        char buff[70];                                           \
-        if (strftime(buff, sizeof buff, "%A %c", localtime(&t))) \
-            __CTF_LOG("%s", buff);                               \
-        else                                                     \
-            __CTF_LOG("Could not get date and time info.");      \
+/* Runs the registered tests of one suite the way __CTF_SUITE_MAKE/__CTF_SUITE_END run a linked suite */
+static void __CTF_RUN_REGISTERED_SUITE(__CTF_Test_Suite suite)
+{
+    int rule = 22 + (int)strlen(suite.name) - 2;
+    __ctf_current_test_suite_name = (char *)suite.name;
+    if (!__ctf_quiet)
+    {
+        __CTF_PRINT_RULE('+', rule);
+        __CTF_LOG_TIME();
     }
+    double test_start_time = __CTF_NOW();
+    __CTF_SUITE_RUN_TESTS(suite);
+    double test_runtime_sec = __CTF_NOW() - test_start_time;
+    __ctf_current_test_name = NULL;
+    __ctf_current_test_suite_name = NULL;
+    if (__ctf_quiet)
+        return;
+    __CTF_LOG("\nTest suite %s\"%s\"%s tests ran for %fs.", __CTF_ANSI_YELLOW, suite.name, __CTF_ANSI_RESET, test_runtime_sec);
+    __CTF_PRINT_RULE('-', rule);
+}
 
-#define __CTF_SUITE_RUN_IMPL(name)                \
-    do                                            \
-    {                                             \
-        if (__ctf_use_signal_handlers)            \
-            __CTF_REGISTER_SIGNAL_HANDLERS();     \
-        name##_suite_func();                      \
-        __ctf_suites_ran++;                       \
-        if (__ctf_use_signal_handlers)            \
-            __CTF_RESET_SIGNAL_HANDLERS();        \
-    } while (0)
+/* Runs the index-th suite of an array of selected registry groups */
+static void __CTF_RUN_REGISTRY_GROUP(const void *suites, int index)
+{
+    if (__ctf_use_signal_handlers)
+        __CTF_REGISTER_SIGNAL_HANDLERS();
+    __CTF_RUN_REGISTERED_SUITE(((const __CTF_Test_Suite *)suites)[index]);
+    if (!__ctf_repeat_outer || __ctf_iteration == 0)
+        __ctf_suites_ran++;
+    if (__ctf_use_signal_handlers)
+        __CTF_RESET_SIGNAL_HANDLERS();
+}
 
+/* Orders registry entries by suite name, entries of one suite keep their order in the section */
+static int __CTF_REGISTRY_COMPARE(const void *a, const void *b)
+{
+    const __CTF_Test *x = *(const __CTF_Test *const *)a, *y = *(const __CTF_Test *const *)b;
+    int order = strcmp(x->suite_name, y->suite_name);
+    return order ? order : (x > y) - (x < y);
+}
 
-#define __CTF_SUITE_MAKE_IMPL(__name)          \
-    static __CTF_Test_Suite __name##_suite = { \
-        NULL,                                  \
-        0,                                     \
-        0,                                     \
-        #__name,                               \
-    };                                         \
-    static void __name##_suite_func()
+/* Runs the registered tests from begin to end, grouped by suite */
+static void __CTF_RUN_REGISTRY(const __CTF_Test *begin, const __CTF_Test *end)
+{
+    __CTF_Test_Suite *suites = NULL;
+    int count = 0, capacity = 0, total = begin ? (int)(end - begin) : 0, i;
+    if (total <= 0)
+        return;
+    /* The registry is read only and a suite's entries need not be adjacent in it, so suites run from a sorted copy */
+    const __CTF_Test **order = (const __CTF_Test **)malloc(total * sizeof(const __CTF_Test *));
+    __CTF_Test *tests = (__CTF_Test *)malloc(total * sizeof(__CTF_Test));
+    if (!order || !tests)
+    {
+        free(order);
+        free(tests);
+        __CTF_LOG("%sOut of memory grouping the registered tests.%s", __CTF_ANSI_RED, __CTF_ANSI_RESET);
+        return;
+    }
+    for (i = 0; i < total; i++)
+        order[i] = begin + i;
+    qsort(order, total, sizeof(const __CTF_Test *), __CTF_REGISTRY_COMPARE);
+    for (i = 0; i < total; i++)
+        tests[i] = *order[i];
+    free(order);
+    begin = tests;
+    end = tests + total;
+    while (begin < end)
+    {
+        const __CTF_Test *group = begin;
+        while (group < end && strcmp(group->suite_name, begin->suite_name) == 0)
+            group++;
+        __CTF_Test_Suite suite = {(__CTF_Test *)begin, (int)(group - begin), 0, begin->suite_name, NULL, NULL};
+        begin = group;
+        if (!__CTF_FILTER_SUITE(suite.name))
+            continue;
+        if (__ctf_list_only)
+        {
+            __CTF_LIST_TESTS(&suite);
+            continue;
+        }
+        if (!__CTF_REPEATING())
+        {
+            __CTF_RUN_REGISTRY_GROUP(&suite, 0);
+            continue;
+        }
+        /* Repeated passes go over every selected suite, in a new order each with --shuffle */
+        if (count == capacity)
+        {
+            __CTF_Test_Suite *grown = (__CTF_Test_Suite *)realloc(suites, (capacity ? capacity * 2 : 16) * sizeof(__CTF_Test_Suite));
+            if (!grown)
+                break;
+            suites = grown;
+            capacity = capacity ? capacity * 2 : 16;
+        }
+        suites[count++] = suite;
+    }
+    if (count > 0)
+        __CTF_REPEAT_SUITES(suites, count, __CTF_RUN_REGISTRY_GROUP);
+    free(suites);
+    free(tests);
+}
 
-#define __CTF_SUITE_END_IMPL(name)                                                                                             \
-    do                                                                                                                         \
-    {                                                                                                                          \
-        clock_t test_start_time = clock();                                                                                     \
-        __CTF_SUITE_RUN_TESTS(name##_suite);                                                                                   \
-        clock_t test_runtime = clock() - test_start_time;                                                                      \
-        float test_runtime_sec = (double)(test_runtime) / CLOCKS_PER_SEC;                                                      \
-        __CTF_LOG("\nTest suite %s\"%s\"%s tests ran for %fs.", __CTF_ANSI_YELLOW, #name, __CTF_ANSI_RESET, test_runtime_sec); \
-        free((name##_suite).tests);                                                                                            \
-        __ctf_current_test_name = NULL;                                                                                        \
-        __ctf_current_test_suite_name = NULL;                                                                                  \
-        __CTF_SUITE_INIT_IMPL_i = __CTF_SUITE_INIT_IMPL_j;                                                                     \
-        while (__CTF_SUITE_INIT_IMPL_i--)                                                                                      \
-        {                                                                                                                      \
-            putchar('-');                                                                                                      \
-        }                                                                                                                      \
-        putchar('\n');                                                                                                         \
-    } while (0)
+/**
+ * @brief Runs every test placed in the registry by __CTF_REGISTER, grouped by suite.
+ *
+ */
+__CTF_API __CTF_MAYBE_UNUSED void __CTF_RUN_REGISTERED_IMPL(void)
+{
+    if (!__CTF_HAS_REGISTRY)
+    {
+        __CTF_LOG("%sStatic registration is not supported on this platform, use CTF_SUITE_LINK.%s", __CTF_ANSI_RED, __CTF_ANSI_RESET);
+        return;
+    }
+    __CTF_RUN_REGISTRY(__CTF_REGISTRY_BEGIN, __CTF_REGISTRY_END);
+}
+
+/**
+ * @brief Runs every suite made with __CTF_SUITE_MAKE in any translation unit, in link order.
+ *
+ */
+__CTF_API __CTF_MAYBE_UNUSED void __CTF_RUN_SUITES_IMPL(void)
+{
+    const __CTF_Suite_Entry *entry = __CTF_SUITE_REGISTRY_BEGIN, *end = __CTF_SUITE_REGISTRY_END;
+    if (!__CTF_HAS_REGISTRY)
+    {
+        __CTF_LOG("%sStatic registration is not supported on this platform, use CTF_SUITE_RUN.%s", __CTF_ANSI_RED, __CTF_ANSI_RESET);
+        return;
+    }
+    __CTF_RUN_SUITE_ENTRIES(entry, end);
+}
 
-static void __CTF_PROCESS_INIT_IMPL(int argc, char **argv)
+__CTF_API __CTF_MAYBE_UNUSED void __CTF_PROCESS_INIT_IMPL(int argc, char **argv)
 {
     int i;
+    bool repeat_set = false;
+    bool cache_set = false, no_cache = false;
     for (i = 0; i < argc; i++)
     {
         if (strcmp(argv[i], "-nc") == 0 || strcmp(argv[i], "-no-color") == 0)
@@ -686,6 +7277,220 @@ static void __CTF_PROCESS_INIT_IMPL(int argc, char **argv)
         {
             __ctf_use_signal_handlers = false;
         }
+        else if (strcmp(argv[i], "--save-baseline") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_save_baseline = argv[i + 1];
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "--compare-baseline") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_compare_baseline = argv[i + 1];
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "--samples") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_baseline_samples = atoi(argv[i + 1]);
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "--threshold") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_baseline_alpha = atof(argv[i + 1]);
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "--min-change") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_baseline_min_change = atof(argv[i + 1]);
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_seed = strtoull(argv[i + 1], NULL, 10);
+                __ctf_seed_set = true;
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "--prop-runs") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_prop_runs = strtoul(argv[i + 1], NULL, 10);
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "--trace") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_trace_file = argv[i + 1];
+                __ctf_trace = true;
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "--cache") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_cache_file = argv[i + 1];
+                cache_set = true;
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "--no-cache") == 0)
+        {
+            no_cache = true;
+        }
+        else if (strcmp(argv[i], "--failed-first") == 0)
+        {
+            __ctf_failed_first = true;
+        }
+        else if (strcmp(argv[i], "--last-failed") == 0)
+        {
+            __ctf_last_failed = true;
+        }
+        else if (strcmp(argv[i], "--incremental") == 0)
+        {
+            __ctf_incremental = true;
+        }
+        else if (strcmp(argv[i], "--shard") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                int shard = 0, shards = 0;
+                if (sscanf(argv[i + 1], "%d/%d", &shard, &shards) == 2 && shards >= 1 && shard >= 1 && shard <= shards)
+                {
+                    __ctf_shard = shard - 1;
+                    __ctf_shards = shards;
+                }
+                else
+                {
+                    fprintf(stderr, "Invalid --shard \"%s\", expected i/N with 1 <= i <= N.\n", argv[i + 1]);
+                    exit(2);
+                }
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "--shard-history") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_shard_history_file = argv[i + 1];
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "--repeat") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_repeat = strtoull(argv[i + 1], NULL, 10);
+                repeat_set = true;
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "--until-fail") == 0)
+        {
+            __ctf_until_fail = true;
+        }
+        else if (strcmp(argv[i], "--shuffle") == 0)
+        {
+            __ctf_shuffle = true;
+        }
+        else if (strcmp(argv[i], "--isolate") == 0)
+        {
+            __ctf_isolate = true;
+        }
+        else if (strcmp(argv[i], "--perf") == 0)
+        {
+            __ctf_perf = true;
+        }
+        else if (strcmp(argv[i], "--bench-time") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_bench_time = atof(argv[i + 1]);
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "--bench-samples") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_bench_samples = atoi(argv[i + 1]);
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--reporter") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_reporter_name = argv[i + 1];
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--report-file") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_report_file_name = argv[i + 1];
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "--list") == 0)
+        {
+            __ctf_list_only = true;
+        }
+        else if (strcmp(argv[i], "--watch") == 0)
+        {
+            __ctf_watch = true;
+        }
+        else if (strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--filter") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __CTF_FILTER_ADD(argv[i + 1]);
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timeout") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_timeout_ms = strtoul(argv[i + 1], NULL, 10);
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                __ctf_jobs = atoi(argv[i + 1]);
+                i++;
+            }
+            if (__ctf_jobs <= 0)
+            {
+#if defined(__CTF_POSIX) && defined(_SC_NPROCESSORS_ONLN)
+                __ctf_jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+                if (__ctf_jobs <= 0)
+                    __ctf_jobs = 1;
+            }
+        }
         else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0)
         {
             printf("Usage: %s [-nc|-no-color] [-h|-help]\n", argv[0]);
@@ -694,15 +7499,295 @@ static void __CTF_PROCESS_INIT_IMPL(int argc, char **argv)
             printf("\t-ns, --no-signal\t\tDisable internal signal handlers (useful for debugging).\n");
             printf("\t-as, --ask-signal\tAsk the user if they want to continue testing after a signal is caught.\n");
             printf("\t-l, --log\t\tSpecify a log file name.\n");
+            printf("\t-j, --jobs N\t\tRun the tests of each suite on N worker threads (0 for one per core).\n");
+            printf("\t-r, --reporter NAME\tAlso report results as json (JSON Lines), junit (JUnit XML) or tap.\n");
+            printf("\t-o, --report-file F\tWrite the --reporter output to F instead of stdout, which otherwise replaces the console output.\n");
+            printf("\t--list\t\t\tList the selected tests as Suite/Test without running them.\n");
+            printf("\t--watch\t\t\tWith ctf-runner, reload and rerun a test module every time it is rebuilt.\n");
+            printf("\t-f, --filter P\t\tOnly run tests matching the comma separated Suite/Test globs in P, prefix a glob with - to exclude.\n");
+            printf("\t-t, --timeout MS\tAbort tests that run longer than MS milliseconds and report them as timed out.\n");
+            printf("\t--save-baseline F\tWrite the timing samples of every passing test to F.\n");
+            printf("\t--compare-baseline F\tCompare timings against F and exit with 1 if any test regressed.\n");
+            printf("\t--samples N\t\tRuns per test when saving or comparing a baseline (default 10), plain tests are rerun side effects and all, benchmarks use their own samples.\n");
+            printf("\t--threshold P\t\tSignificance level of the Mann-Whitney U test against the baseline (default 0.05).\n");
+            printf("\t--min-change PCT\tSmallest change of the median counted as a regression or improvement (default 2).\n");
+            printf("\t--trace F\t\tWrite a timeline of suites, tests, CTF_SPAN and CTF_COUNTER to F in Chrome trace event format.\n");
+            printf("\t--cache F\t\tRecord the result of every test in F, the options below use ctf.cache without it.\n");
+            printf("\t--no-cache\t\tNeither read nor write the result cache, even with the options below.\n");
+            printf("\t--failed-first\t\tRun the tests that failed last time first.\n");
+            printf("\t--last-failed\t\tOnly run the tests that failed last time, or every test if none did.\n");
+            printf("\t--incremental\t\tSkip tests that passed last time with the same build of the test binary.\n");
+            printf("\t--shard i/N\t\tOnly run the i-th of N parts of the tests, split by a hash of their names.\n");
+            printf("\t--shard-history F\tBalance the --shard parts by the durations in F, a result cache every node shares and none writes.\n");
+            printf("\t--repeat N\t\tRun the tests N times (0 until interrupted) and report failure rates and timing variance per test, a CTF_SUITE_RUN suite repeats on its own.\n");
+            printf("\t--until-fail\t\tStop repeating after the first pass with a failure, repeats until then without --repeat.\n");
+            printf("\t--shuffle\t\tRun the tests and suites in a random order, a new one every pass, replayed with --seed. Only suites run by CTF_RUN_SUITES or CTF_RUN_REGISTERED are reordered, CTF_SUITE_RUN calls keep main's order.\n");
+            printf("\t--isolate\t\tRun every test in its own process forked from a per suite zygote, so crashes can't affect later tests.\n");
+            printf("\t--seed S\t\tSeed the random inputs of properties and the --shuffle orders with S to replay a failure.\n");
+            printf("\t--prop-runs N\t\tRandom inputs checked per property (default 1000).\n");
+            printf("\t--perf\t\t\tRecord cycles, instructions, cache and branch misses, page faults, context switches and peak RSS per test.\n");
+            printf("\t--bench-time S\t\tSeconds to spend measuring each benchmark, split between the sizes of a range (default 0.5).\n");
+            printf("\t--bench-samples N\tNumber of timed samples per benchmark (default 50).\n");
             printf("\t-h, -help\t\tShow this help message.\n");
             exit(0);
         }
     }
     __ctf_current_test_name = NULL;
     __ctf_current_test_suite_name = NULL;
-    __ctf_process_start_time = clock();
-    __ctf_log_file = fopen(__CTF_LOG_FILE_NAME, "w");
+    __ctf_program_path = argc > 0 ? argv[0] : NULL;
+    if (__ctf_until_fail && !repeat_set)
+        __ctf_repeat = 0;
+    __ctf_cache_enabled = !no_cache && (cache_set || __ctf_failed_first || __ctf_last_failed || __ctf_incremental);
+    if (__ctf_shards > 1 && __ctf_shard_history_file)
+        __CTF_SHARD_HISTORY_LOAD(__ctf_shard_history_file);
+    __ctf_process_start_time = __CTF_NOW();
+    __ctf_trace_origin = __CTF_NOW_NS();
+    if (!__ctf_list_only)
+    {
+        __ctf_log_file = fopen(__CTF_LOG_FILE_NAME, "w");
+        __CTF_REPORTERS_INIT();
+        if (__ctf_compare_baseline)
+            __CTF_BASELINE_LOAD(__ctf_compare_baseline);
+    }
     __CTF_LOG("C Testing framework (CTF) initialized.");
     __CTF_LOG_TIME();
+    if (__CTF_REPEATING())
+        __CTF_REPEAT_INTERRUPTIBLE();
+    if (__CTF_REPEATING() && __ctf_shuffle)
+        __CTF_LOG("Shuffling with seed %llu.", __CTF_SEED());
+}
+
+/*
+    Test runner (ctf-runner).
+
+    Compiling this header on its own with CTF_SHARED, CTF_IMPLEMENTATION and CTF_RUNNER defined gives a main that
+    loads test modules instead of linking them in:
+
+        cc -DCTF_SHARED -DCTF_IMPLEMENTATION -DCTF_RUNNER -x c ctf.h -o ctf-runner -rdynamic -lpthread -ldl
+        cc -DCTF_SHARED -shared -fPIC vec_tests.c -o vec_tests.so
+        ./ctf-runner --watch -- ./vec_tests.so ./map_tests.so
+
+    A module is a shared object built from translation units that include this header with CTF_SHARED. It resolves
+    the runtime against the runner, hence -rdynamic, and exports __ctf_module so the runner can find its suites and
+    registered tests, which all run once it is loaded. With --watch the runner then waits on inotify for modules to
+    be rebuilt and reloads and reruns only those, while the log, the result cache and the rest of the process stay
+    warm. Modules are loaded from a private copy, so a build rewriting the file never pulls pages out from under a
+    running test and every reload maps the new code. With --trace old copies stay loaded because the timeline still
+    points at their names.
+*/
+
+#if defined(CTF_RUNNER) && defined(__CTF_POSIX)
+
+/* Quiet time after the last change event before a module is reloaded, builds write in several steps */
+#define __CTF_RUNNER_SETTLE_MS 150
+
+typedef struct
+{
+    const char *path;
+    void *handle;
+    __CTF_Module contents;
+    /* Of the copy that was loaded, --incremental compares against it rather than the runner */
+    unsigned long long fingerprint;
+    int watch;
+    bool changed;
+} __CTF_Runner_Module;
+
+static volatile sig_atomic_t __ctf_runner_stop = 0;
+
+static void __CTF_RUNNER_INTERRUPT(int sig)
+{
+    (void)sig;
+    __ctf_runner_stop = 1;
+}
+
+/* Copies the module to a private file and loads it, the previous copy is only unloaded once the new one loaded */
+static bool __CTF_RUNNER_LOAD(__CTF_Runner_Module *module)
+{
+    char copy[] = "/tmp/ctf-module-XXXXXX";
+    char buffer[65536];
+    ssize_t length = 0;
+    int out = mkstemp(copy);
+    int in = open(module->path, O_RDONLY);
+    bool copied = out >= 0 && in >= 0;
+    while (copied && (length = read(in, buffer, sizeof(buffer))) != 0)
+    {
+        if (length < 0 && errno == EINTR)
+            continue;
+        copied = length > 0 && __CTF_FD_WRITE(out, buffer, (size_t)length);
+    }
+    if (in >= 0)
+        close(in);
+    if (out >= 0)
+        close(out);
+    void *handle = copied ? dlopen(copy, RTLD_NOW | RTLD_LOCAL) : NULL;
+    unsigned long long fingerprint = handle && __ctf_cache_enabled ? __CTF_FINGERPRINT_FILE(fopen(copy, "rb")) : 0;
+    if (out >= 0)
+        unlink(copy);
+    if (!handle)
+    {
+        __CTF_LOG("%sCould not load module %s: %s%s", __CTF_ANSI_RED, module->path, copied ? dlerror() : strerror(errno), __CTF_ANSI_RESET);
+        return false;
+    }
+    void (*describe)(__CTF_Module *);
+    *(void **)(&describe) = dlsym(handle, "__ctf_module");
+    if (!describe)
+    {
+        __CTF_LOG("%sModule %s has no tests, build it from files including ctf.h with CTF_SHARED.%s", __CTF_ANSI_RED, module->path, __CTF_ANSI_RESET);
+        dlclose(handle);
+        return false;
+    }
+    if (module->handle && !__ctf_trace)
+        dlclose(module->handle);
+    module->handle = handle;
+    module->fingerprint = fingerprint;
+    memset(&module->contents, 0, sizeof(module->contents));
+    describe(&module->contents);
+    return true;
+}
+
+static void __CTF_RUNNER_RUN(const __CTF_Runner_Module *module)
+{
+    __ctf_fingerprint = module->fingerprint;
+    __ctf_fingerprint_ready = true;
+    __CTF_RUN_SUITE_ENTRIES(module->contents.suites, module->contents.suites_end);
+    __CTF_RUN_REGISTRY(module->contents.tests, module->contents.tests_end);
+    __CTF_LOG_FLUSH();
+}
+
+/* Reruns modules as they are rebuilt until interrupted */
+static void __CTF_RUNNER_WATCH(__CTF_Runner_Module *modules, int count)
+{
+#ifdef __linux__
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    int i;
+    if (fd < 0)
+    {
+        __CTF_LOG("%sCould not watch the modules: %s%s", __CTF_ANSI_RED, strerror(errno), __CTF_ANSI_RESET);
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        /* Builds replace the file, so the directory is watched rather than the file itself */
+        char directory[4096];
+        const char *slash = strrchr(modules[i].path, '/');
+        size_t length = slash ? (size_t)(slash - modules[i].path) : 0;
+        if (length >= sizeof(directory))
+            length = sizeof(directory) - 1;
+        memcpy(directory, modules[i].path, length);
+        directory[length] = '\0';
+        modules[i].watch = inotify_add_watch(fd, slash ? (length ? directory : "/") : ".", IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    }
+    struct sigaction interrupt, old_int, old_term;
+    memset(&interrupt, 0, sizeof(interrupt));
+    interrupt.sa_handler = __CTF_RUNNER_INTERRUPT;
+    sigemptyset(&interrupt.sa_mask);
+    sigaction(SIGINT, &interrupt, &old_int);
+    sigaction(SIGTERM, &interrupt, &old_term);
+    __CTF_LOG("Watching %d module(s) for changes, press Ctrl-C to stop.", count);
+    __CTF_LOG_FLUSH();
+    while (!__ctf_runner_stop)
+    {
+        bool pending = false;
+        for (i = 0; i < count; i++)
+            pending = pending || modules[i].changed;
+        struct pollfd ready = {fd, POLLIN, 0};
+        int events = poll(&ready, 1, pending ? __CTF_RUNNER_SETTLE_MS : -1);
+        if (events < 0 && errno == EINTR)
+            continue;
+        if (events < 0)
+            break;
+        if (events == 0)
+        {
+            for (i = 0; i < count; i++)
+            {
+                if (!modules[i].changed)
+                    continue;
+                modules[i].changed = false;
+                __CTF_LOG("%sReloading %s%s", __CTF_ANSI_BLUE, modules[i].path, __CTF_ANSI_RESET);
+                if (__CTF_RUNNER_LOAD(&modules[i]))
+                    __CTF_RUNNER_RUN(&modules[i]);
+            }
+            continue;
+        }
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t length;
+        while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+        {
+            const char *at = buffer;
+            while (at < buffer + length)
+            {
+                const struct inotify_event *event = (const struct inotify_event *)at;
+                for (i = 0; event->len && i < count; i++)
+                {
+                    const char *slash = strrchr(modules[i].path, '/');
+                    if (modules[i].watch == event->wd && strcmp(event->name, slash ? slash + 1 : modules[i].path) == 0)
+                        modules[i].changed = true;
+                }
+                at += sizeof(struct inotify_event) + event->len;
+            }
+        }
+    }
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    close(fd);
+#else
+    (void)modules;
+    (void)count;
+    __CTF_LOG("--watch needs inotify, the modules were run once.");
+#endif
+}
+
+/**
+ * @brief Main of ctf-runner, options go before "--" and the modules after it.
+ *
+ */
+static int __CTF_RUNNER_MAIN(int argc, char **argv)
+{
+    int i, first = argc;
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--") == 0)
+        {
+            first = i + 1;
+            break;
+        }
+    }
+    if (first >= argc && !(argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "-help") == 0)))
+    {
+        fprintf(stderr, "Usage: %s [options] -- module.so...\n", argc > 0 ? argv[0] : "ctf-runner");
+        return 2;
+    }
+    __CTF_PROCESS_INIT_IMPL(first < argc ? first - 1 : argc, argv);
+    int count = argc - first;
+    __CTF_Runner_Module *modules = (__CTF_Runner_Module *)calloc(count, sizeof(__CTF_Runner_Module));
+    if (!modules)
+        __CTF_PROCESS_EXIT_IMPL();
+    for (i = 0; i < count; i++)
+    {
+        modules[i].path = argv[first + i];
+        modules[i].watch = -1;
+        if (__CTF_RUNNER_LOAD(&modules[i]))
+            __CTF_RUNNER_RUN(&modules[i]);
+    }
+    if (__ctf_watch && !__ctf_list_only)
+        __CTF_RUNNER_WATCH(modules, count);
+    free(modules);
+    __CTF_PROCESS_EXIT_IMPL();
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    return __CTF_RUNNER_MAIN(argc, argv);
+}
+
+#elif defined(CTF_RUNNER)
+#error "CTF_RUNNER loads modules with dlopen and needs a POSIX system, build it with -std=gnu* or -D_GNU_SOURCE."
+#endif
+
+#endif /* __CTF_DECLARATIONS_ONLY */
+
+#ifdef __cplusplus
 }
+#endif
 #endif /* _CTF_FRAMEWORK_H */
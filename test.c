@@ -18,12 +18,94 @@ CTF_TEST(CTF_fail)
     CTF_FAIL();
 }
 
+/* Memory from CTF_ALLOC is reclaimed by the runner after the test, so asserts need no cleanup */
+CTF_TEST(CTF_arena)
+{
+    int *squares = (int *)CTF_ALLOC(100 * sizeof(int));
+    CTF_ASSERT(squares != NULL);
+    int i;
+    for (i = 0; i < 100; i++)
+        squares[i] = i * i;
+    CTF_ASSERT(squares[9] == 81);
+    CTF_PASS();
+}
+
+/* The body runs on 4 threads released together, an assert only fails the thread it runs on */
+static _Atomic long shared_hits;
+CTF_TEST_THREADED(CTF_threaded, 4)
+{
+    int i;
+    for (i = 0; i < 10000; i++)
+        atomic_fetch_add(&shared_hits, 1);
+    CTF_THREAD_OPS(10000);
+    CTF_ASSERT(atomic_load(&shared_hits) >= 10000);
+    CTF_PASS();
+}
+
+#if defined(__unix__) && (defined(_DEFAULT_SOURCE) || defined(_GNU_SOURCE))
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/wait.h>
+
+static void *crash_outside_test(void *arg)
+{
+    volatile int *ptr = (volatile int *)arg;
+    return (void *)(size_t)*ptr;
+}
+
+/* A crash outside of any test still writes out the log lines queued before it. The child logs a line and then
+   crashes on a thread that runs no test, the line has to reach the parent through the pipe. The crash report
+   itself goes to /dev/null. */
+CTF_TEST(CTF_crash_keeps_log)
+{
+    int out[2];
+    CTF_ASSERT(pipe(out) == 0);
+    fflush(stdout);
+    pid_t child = fork();
+    CTF_ASSERT(child >= 0);
+    if (child == 0)
+    {
+        pthread_t thread;
+        int quiet = open("/dev/null", O_WRONLY);
+        dup2(out[1], STDOUT_FILENO);
+        if (quiet >= 0)
+            dup2(quiet, STDERR_FILENO);
+        close(out[0]);
+        CTF_LOG("Queued before the crash");
+        if (pthread_create(&thread, NULL, crash_outside_test, NULL) == 0)
+            pthread_join(thread, NULL);
+        _exit(0);
+    }
+    close(out[1]);
+    char text[4096];
+    size_t length = 0;
+    ssize_t got;
+    while (length < sizeof(text) - 1 && (got = read(out[0], text + length, sizeof(text) - 1 - length)) > 0)
+        length += (size_t)got;
+    text[length] = '\0';
+    close(out[0]);
+    int status = 0;
+    CTF_ASSERT(waitpid(child, &status, 0) == child);
+    CTF_ASSERT(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+    CTF_ASSERT(strstr(text, "Queued before the crash") != NULL);
+    CTF_PASS();
+}
+#endif
+
 /* This is one way of defining a test suite. */
 CTF_SUITE_MAKE(Example)
 {
     CTF_SUITE_INIT(Example);
     CTF_SUITE_LINK(Example, CTF_example);
     CTF_SUITE_LINK(Example, CTF_fail);
+    CTF_SUITE_LINK(Example, CTF_arena);
+    CTF_SUITE_LINK(Example, CTF_threaded);
+#if defined(__unix__) && (defined(_DEFAULT_SOURCE) || defined(_GNU_SOURCE))
+    CTF_SUITE_LINK(Example, CTF_crash_keeps_log);
+#endif
     CTF_SUITE_END(Example);
 }
 
@@ -52,6 +134,76 @@ CTF_TEST(Vector_Test)
 */
 CTF_SUITE(Vec, CTF_SUITE_LINK(Vec, Vector_Test))
 
+/* Bulk asserts compare whole buffers at once and report the first mismatching index */
+CTF_TEST(Vector_Bulk_Test)
+{
+    int expected[64];
+    int i;
+    Vec *int_vec = VEC(int);
+    CTF_ASSERT(int_vec != NULL);
+    {
+        /* Shows up as a region inside the test with --trace */
+        CTF_SPAN("fill");
+        for (i = 0; i < 64; i++)
+        {
+            expected[i] = i * 3;
+            vec_push_back(int_vec, &expected[i]);
+        }
+        CTF_COUNTER("vector length", int_vec->len);
+    }
+    CTF_ASSERT_CLEAN(int_vec->len == 64, vec_free(int_vec));
+    /* Copy out to arena memory so the vector can be freed before asserting on its contents */
+    int *actual = (int *)CTF_ALLOC(sizeof(expected));
+    CTF_ASSERT_CLEAN(actual != NULL, vec_free(int_vec));
+    memcpy(actual, vec_at(int_vec, 0), sizeof(expected));
+    vec_free(int_vec);
+    CTF_ASSERT_ARRAY_EQ(int, actual, expected, 64);
+    CTF_PASS();
+}
+
+/* Benchmarks are linked like tests, only the code inside CTF_BENCH_LOOP is timed */
+CTF_BENCH(Vector_Push_Bench)
+{
+    Vec *int_vec = VEC(int);
+    CTF_ASSERT(int_vec != NULL);
+    int tmp = 5;
+    CTF_BENCH_LOOP
+    {
+        vec_push_back(int_vec, &tmp);
+    }
+    CTF_DO_NOT_OPTIMIZE(int_vec->len);
+    vec_free(int_vec);
+    CTF_PASS();
+}
+
+/* Measured at N = 16, 256, 4096 and 65536, filling a vector should stay linear in N */
+CTF_BENCH_RANGE(Vector_Fill_Range, 16, 65536, 16)
+{
+    long long i, n = CTF_RANGE_N;
+    CTF_SET_ITEMS(n);
+    CTF_SET_BYTES(n * sizeof(int));
+    CTF_EXPECT_COMPLEXITY(CTF_O_N);
+    CTF_BENCH_LOOP
+    {
+        Vec *int_vec = VEC(int);
+        for (i = 0; i < n; i++)
+        {
+            int value = (int)i;
+            vec_push_back(int_vec, &value);
+        }
+        CTF_DO_NOT_OPTIMIZE(int_vec->len);
+        vec_free(int_vec);
+    }
+    CTF_PASS();
+}
+
+/* Whole buffer asserts and benchmarks over vectors */
+CTF_SUITE(Vec_Bulk, {
+    CTF_SUITE_LINK(Vec_Bulk, Vector_Bulk_Test);
+    CTF_SUITE_LINK(Vec_Bulk, Vector_Push_Bench);
+    CTF_SUITE_LINK(Vec_Bulk, Vector_Fill_Range);
+})
+
 #include "../Map/map.h"
 #include "../Map/map.c"
 
@@ -106,12 +258,108 @@ CTF_TEST(Map_Malloc_Test)
     CTF_PASS();
 }
 
+/* A table driven test, the body runs once per element and every case is reported as Map_Param_Test[i] */
+static const int map_param_keys[] = {0, 1, -1, 42, 1000000, -2147483647};
+
+CTF_TEST_PARAM(Map_Param_Test, int, map_param_keys)
+{
+    Map *int_map = MAP(int, int);
+    CTF_ASSERT(int_map != NULL);
+    int_map->type.key_cmp = int_map_cmp_int;
+    int key = CTF_PARAM, value = (int)CTF_PARAM_INDEX;
+    map_add(int_map, &key, &value);
+    int *found = (int *)map_get(int_map, &key);
+    CTF_ASSERT_CLEAN(found != NULL && *found == value, map_free(int_map));
+    map_free(int_map);
+    CTF_PASS();
+}
+
+/* A property is checked against random inputs, a failure is shrunk and printed with the seed to replay it */
+CTF_PROPERTY(Map_Property, CTF_GEN_INT(-100000, 100000), CTF_GEN_INT(-100000, 100000))
+{
+    Map *int_map = MAP(int, int);
+    CTF_ASSERT(int_map != NULL);
+    int_map->type.key_cmp = int_map_cmp_int;
+    int key = (int)CTF_ARG_INT(0), value = (int)CTF_ARG_INT(1);
+    map_add(int_map, &key, &value);
+    int *found = (int *)map_get(int_map, &key);
+    CTF_ASSERT_CLEAN(found != NULL && *found == value, map_free(int_map));
+    map_free(int_map);
+    CTF_PASS();
+}
+
+/* Built once by the suite setup and only read by the tests, so they can share it even with -j */
+static Map *shared_squares = NULL;
+
+CTF_SUITE_SETUP(Map)
+{
+    shared_squares = MAP(int, int);
+    CTF_ASSERT(shared_squares != NULL);
+    shared_squares->type.key_cmp = int_map_cmp_int;
+    int i;
+    for (i = 0; i < 1000; i++)
+    {
+        int square = i * i;
+        map_add(shared_squares, &i, &square);
+    }
+    CTF_PASS();
+}
+
+CTF_SUITE_TEARDOWN(Map)
+{
+    if (shared_squares)
+        map_free(shared_squares);
+    shared_squares = NULL;
+    CTF_PASS();
+}
+
+CTF_TEST(Map_Shared_Test)
+{
+    int key = 31;
+    int *found = (int *)map_get(shared_squares, &key);
+    CTF_ASSERT(found != NULL && *found == 961);
+    CTF_PASS();
+}
+
+/* A fixture gives every test using it a fresh map, torn down even if the test crashes */
+static void *int_map_setup(void)
+{
+    Map *int_map = MAP(int, int);
+    if (int_map)
+        int_map->type.key_cmp = int_map_cmp_int;
+    return int_map;
+}
+
+static void int_map_teardown(void *int_map)
+{
+    if (int_map)
+        map_free((Map *)int_map);
+}
+
+CTF_FIXTURE(Int_Map, int_map_setup, int_map_teardown);
+
+CTF_TEST_FIXTURE(Map_Fixture_Test, Int_Map)
+{
+    Map *int_map = (Map *)CTF_FIXTURE_DATA;
+    CTF_ASSERT(int_map != NULL);
+    int key = 7, value = 49;
+    map_add(int_map, &key, &value);
+    CTF_ASSERT(int_map->length == 1);
+    CTF_PASS();
+}
+
 /* The second arg of CTF_SUITE can be ran like a closure so you can do anything you want on top of linking tests. The second arg could also be a CTF_BLOCK */
 CTF_SUITE(
     Map,
     {
         CTF_SUITE_LINK(Map, Map_Test);
         CTF_SUITE_LINK(Map, Map_Malloc_Test);
+        CTF_SUITE_LINK(Map, Map_Param_Test);
+        CTF_SUITE_LINK(Map, Map_Property);
+        CTF_SUITE_LINK(Map, Map_Shared_Test);
+        CTF_SUITE_LINK(Map, Map_Fixture_Test);
+        CTF_SUITE_LINK_SETUP(Map);
+        CTF_SUITE_LINK_TEARDOWN(Map);
     })
 
 CTF_TEST(Null_Deref)
@@ -146,6 +394,7 @@ int main(int argc, char **argv)
     CTF_LOG("Running tests...");
     CTF_SUITE_RUN(Example);
     CTF_SUITE_RUN(Vec);
+    CTF_SUITE_RUN(Vec_Bulk);
     CTF_SUITE_RUN(Map);
     CTF_LOG("The following suite should fail");
     CTF_SUITE_RUN(Intentional_Fail);